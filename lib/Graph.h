@@ -9,10 +9,13 @@
 #include <queue>
 #include <limits>
 #include <algorithm>
+#include <memory>
 #include "MutablePriorityQueue.h"
 
 template <class T>
 class Edge;
+template <class T, class Hash>
+class GraphBuilder;
 
 #define INF std::numeric_limits<double>::max()
 
@@ -24,7 +27,7 @@ public:
     Vertex(T in, bool active=true);
     bool operator<(Vertex<T> & vertex) const; // // required by MutablePriorityQueue
 
-    T getInfo() const;
+    const T &getInfo() const;
     std::vector<Edge<T> *> getAdj() const;
     bool isVisited() const;
     bool isProcessing() const;
@@ -32,6 +35,7 @@ public:
     double getDist() const;
     Edge<T> *getPath() const;
     std::vector<Edge<T> *> getIncoming() const;
+    bool isPooled() const;
 
     void setInfo(T info);
     void setVisited(bool visited);
@@ -45,6 +49,7 @@ public:
     void removeOutgoingEdges();
 
     friend class MutablePriorityQueue<Vertex>;
+    template <class, class> friend class GraphBuilder;
 protected:
     T info;                // info node
     std::vector<Edge<T> *> adj;  // outgoing edges
@@ -52,6 +57,7 @@ protected:
     // auxiliary fields
     bool visited = false; // used by DFS, BFS, Prim ...
     bool processing = false; // used by isDAG (in addition to the visited attribute)
+    bool pooled = false; // allocated in a pool of the graph (see GraphBuilder), not with new
     unsigned int indegree; // used by topsort
     double dist = 0;
     Edge<T> *path = nullptr;
@@ -76,23 +82,30 @@ public:
     Vertex<T> * getOrig() const;
     Edge<T> *getReverse() const;
     double getFlow() const;
+    bool isPooled() const;
+    bool isUndirected() const;
 
     void setWeight(double weight);
     void setSelected(bool selected);
     void setReverse(Edge<T> *reverse);
     void setFlow(double flow);
+    void setUndirected(bool undirected);
+
+    template <class, class> friend class GraphBuilder;
 protected:
     Vertex<T> * dest; // destination vertex
     double weight; // edge weight, can also be used for capacity
 
     // auxiliary fields
     bool selected = false;
+    bool pooled = false; // allocated in a pool of the graph (see GraphBuilder), not with new
+    bool undirected = false; // can be used in both directions, with a signed flow (negative from dest to orig)
 
     // used for bidirectional edges
     Vertex<T> *orig;
     Edge<T> *reverse = nullptr;
 
-    double flow; // for flow-related problems
+    double flow = 0; // for flow-related problems
 };
 
 /********************** Graph  ****************************/
@@ -100,6 +113,9 @@ protected:
 template <class T>
 class Graph {
 public:
+    Graph() = default;
+    Graph(const Graph &) = delete;
+    Graph &operator=(const Graph &) = delete;
     ~Graph();
     /*
     * Auxiliary function to find a vertex with a given the content.
@@ -110,6 +126,12 @@ public:
      *  Returns true if successful, and false if a vertex with that content already exists.
      */
     bool addVertex(const T &in, bool active=true);
+    /*
+     *  Adds a vertex with a given content or info (in) to a graph (this), without
+     *  checking if a vertex with that content already exists.
+     *  Returns the new vertex.
+     */
+    Vertex<T> *appendVertex(const T &in, bool active=true);
     bool removeVertex(const T &in);
 
     /*
@@ -134,9 +156,15 @@ public:
     bool isDAG() const;
     bool dfsIsDAG(Vertex<T> *v) const;
     std::vector<T> topsort() const;
+
+    template <class, class> friend class GraphBuilder;
 protected:
     std::vector<Vertex<T> *> vertexSet;    // vertex set
 
+    // contiguous blocks of vertices and edges created by GraphBuilder, released with the graph
+    std::vector<std::pair<Vertex<T> *, size_t>> vertexPools;
+    std::vector<std::pair<Edge<T> *, size_t>> edgePools;
+
     double ** distMatrix = nullptr;   // dist matrix for Floyd-Warshall
     int **pathMatrix = nullptr;   // path matrix for Floyd-Warshall
 
@@ -209,7 +237,7 @@ bool Vertex<T>::operator<(Vertex<T> & vertex) const {
 }
 
 template <class T>
-T Vertex<T>::getInfo() const {
+const T &Vertex<T>::getInfo() const {
     return this->info;
 }
 
@@ -248,6 +276,11 @@ std::vector<Edge<T> *> Vertex<T>::getIncoming() const {
     return this->incoming;
 }
 
+template <class T>
+bool Vertex<T>::isPooled() const {
+    return this->pooled;
+}
+
 template <class T>
 void Vertex<T>::setInfo(T in) {
     this->info = in;
@@ -296,7 +329,8 @@ void Vertex<T>::deleteEdge(Edge<T> *edge) {
             it++;
         }
     }
-    delete edge;
+    if (!edge->isPooled())
+        delete edge;
 }
 
 /********************** Edge  ****************************/
@@ -334,6 +368,21 @@ double Edge<T>::getFlow() const {
     return flow;
 }
 
+template <class T>
+bool Edge<T>::isPooled() const {
+    return this->pooled;
+}
+
+template <class T>
+bool Edge<T>::isUndirected() const {
+    return this->undirected;
+}
+
+template <class T>
+void Edge<T>::setUndirected(bool undirected) {
+    this->undirected = undirected;
+}
+
 template <class T>
 void Edge<T>::setWeight(double weight) {
     this->weight = weight;
@@ -399,6 +448,18 @@ bool Graph<T>::addVertex(const T &in, bool active) {
     return true;
 }
 
+/*
+ *  Adds a vertex with a given content or info (in) to a graph (this), without
+ *  checking if a vertex with that content already exists.
+ *  Returns the new vertex.
+ */
+template <class T>
+Vertex<T> *Graph<T>::appendVertex(const T &in, bool active) {
+    auto v = new Vertex<T>(in, active);
+    vertexSet.push_back(v);
+    return v;
+}
+
 /*
  *  Removes a vertex with a given content (in) from a graph (this), and
  *  all outgoing and incoming edges.
@@ -414,7 +475,8 @@ bool Graph<T>::removeVertex(const T &in) {
                 u->removeEdge(v->getInfo());
             }
             vertexSet.erase(it);
-            delete v;
+            if (!v->isPooled())
+                delete v;
             return true;
         }
     }
@@ -695,6 +757,14 @@ template <class T>
 Graph<T>::~Graph() {
     deleteMatrix(distMatrix, vertexSet.size());
     deleteMatrix(pathMatrix, vertexSet.size());
+    for (auto [pool, n] : vertexPools) {
+        std::destroy_n(pool, n);
+        std::allocator<Vertex<T>>().deallocate(pool, n);
+    }
+    for (auto [pool, n] : edgePools) {
+        std::destroy_n(pool, n);
+        std::allocator<Edge<T>>().deallocate(pool, n);
+    }
 }
 
 #endif /* DA_TP_CLASSES_GRAPH */
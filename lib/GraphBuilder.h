@@ -0,0 +1,348 @@
+/*
+ * GraphBuilder.h
+ * Bulk construction of a Graph: vertices and edges are collected first and the
+ * graph is wired in a single pass, with exact sizes for every array.
+ */
+
+#ifndef DA_TP_CLASSES_GRAPH_BUILDER
+#define DA_TP_CLASSES_GRAPH_BUILDER
+
+#include <functional>
+#include <memory>
+#include <new>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+#include "Graph.h"
+
+/*
+ * Order in which GraphBuilder lays out the vertices (and their outgoing edges) in memory.
+ */
+enum class VertexOrder {
+    Insertion, // the order in which the vertices were queued
+    BFS,       // breadth-first order from the root vertices
+    RCM        // reverse Cuthill-McKee order (small bandwidth)
+};
+
+template <class T, class Hash = std::hash<T>>
+class GraphBuilder {
+public:
+    explicit GraphBuilder(Graph<T> &graph);
+
+    /*
+     * Reserves space for the given number of vertices and edge requests
+     * (a bidirectional edge counts as one request).
+     */
+    void reserve(size_t vertices, size_t edges);
+
+    /*
+     * Queues a vertex with a given content or info (in).
+     * Returns true if successful, and false if a vertex with that content was already queued.
+     * Duplicates are detected by hash, in constant time.
+     */
+    bool addVertex(const T &in, bool active=true);
+
+    /*
+     * Finds the index of a queued vertex with a given content, or -1 if there is none.
+     */
+    int findVertexIdx(const T &in) const;
+
+    /*
+     * Queues an edge between two queued vertices (given by their indexes) with weight w.
+     * Returns true if successful, and false if one of the indexes is not valid.
+     */
+    bool addEdge(int v1, int v2, double w);
+    bool addBidirectionalEdge(int v1, int v2, double w);
+
+    /*
+     * Queues a single undirected edge between two queued vertices: it is stored in the
+     * outgoing edges of v1 and in the incoming edges of v2, with one capacity (w) and a
+     * signed flow shared by both directions (see Edge::isUndirected).
+     */
+    bool addUndirectedEdge(int v1, int v2, double w);
+
+    int getNumVertex() const;
+    size_t getNumEdges() const;
+
+    /*
+     * Creates the queued vertices and edges in the graph.
+     * First pass: counts the in and out degree of every vertex.
+     * Second pass: allocates all the vertices and all the edges in one block each,
+     * reserves the exact adjacency sizes and wires the edges and reverse pointers.
+     * The vertices are laid out by the given order (isRoot selects the starting
+     * vertices of the BFS order) and the edges by the position of their source vertex,
+     * so vertices that are close in the graph are also close in memory. The indexes
+     * used to queue the vertices and edges stay valid in getVertex() and getEdge().
+     * Can only be called once.
+     */
+    void build(VertexOrder order = VertexOrder::Insertion,
+               const std::function<bool(const T &)> &isRoot = nullptr);
+
+    /*
+     * After build(): the vertex created for the i-th queued vertex.
+     */
+    Vertex<T> *getVertex(int i) const;
+
+    /*
+     * After build(): the edge created for the i-th queued edge request
+     * (for bidirectional edges, the edge from v1 to v2; the other one is its reverse).
+     */
+    Edge<T> *getEdge(size_t i) const;
+
+protected:
+    enum class Direction { Forward, Bidirectional, Undirected };
+
+    struct PendingEdge {
+        int orig;
+        int dest;
+        double weight;
+        Direction direction;
+    };
+
+    Graph<T> &graph;
+    std::vector<std::pair<T, bool>> vertices; // queued contents and active flags
+    std::unordered_map<T, int, Hash> index;   // index of each queued content
+    std::vector<PendingEdge> edges;           // queued edge requests
+
+    Vertex<T> *createdVertices = nullptr;
+    std::vector<int> position; // position in memory of each queued vertex
+    std::vector<Edge<T> *> createdEdges;
+    bool built = false;
+
+    /*
+     * Computes the layout of the queued vertices: order[k] is the vertex placed in position k.
+     * The edges are followed in both directions.
+     */
+    std::vector<int> computeOrder(VertexOrder order, const std::function<bool(const T &)> &isRoot) const;
+};
+
+/************************* GraphBuilder  **************************/
+
+template <class T, class Hash>
+GraphBuilder<T, Hash>::GraphBuilder(Graph<T> &graph): graph(graph) {}
+
+template <class T, class Hash>
+void GraphBuilder<T, Hash>::reserve(size_t vertices, size_t edges) {
+    this->vertices.reserve(vertices);
+    this->index.reserve(vertices);
+    this->edges.reserve(edges);
+}
+
+template <class T, class Hash>
+bool GraphBuilder<T, Hash>::addVertex(const T &in, bool active) {
+    if (!index.emplace(in, vertices.size()).second)
+        return false;
+    vertices.emplace_back(in, active);
+    return true;
+}
+
+template <class T, class Hash>
+int GraphBuilder<T, Hash>::findVertexIdx(const T &in) const {
+    auto it = index.find(in);
+    if (it == index.end())
+        return -1;
+    return it->second;
+}
+
+template <class T, class Hash>
+bool GraphBuilder<T, Hash>::addEdge(int v1, int v2, double w) {
+    if (v1 < 0 || v2 < 0 || v1 >= getNumVertex() || v2 >= getNumVertex())
+        return false;
+    edges.push_back({v1, v2, w, Direction::Forward});
+    return true;
+}
+
+template <class T, class Hash>
+bool GraphBuilder<T, Hash>::addBidirectionalEdge(int v1, int v2, double w) {
+    if (v1 < 0 || v2 < 0 || v1 >= getNumVertex() || v2 >= getNumVertex())
+        return false;
+    edges.push_back({v1, v2, w, Direction::Bidirectional});
+    return true;
+}
+
+template <class T, class Hash>
+bool GraphBuilder<T, Hash>::addUndirectedEdge(int v1, int v2, double w) {
+    if (v1 < 0 || v2 < 0 || v1 >= getNumVertex() || v2 >= getNumVertex())
+        return false;
+    edges.push_back({v1, v2, w, Direction::Undirected});
+    return true;
+}
+
+template <class T, class Hash>
+int GraphBuilder<T, Hash>::getNumVertex() const {
+    return vertices.size();
+}
+
+template <class T, class Hash>
+size_t GraphBuilder<T, Hash>::getNumEdges() const {
+    return edges.size();
+}
+
+template <class T, class Hash>
+std::vector<int> GraphBuilder<T, Hash>::computeOrder(VertexOrder order,
+                                                     const std::function<bool(const T &)> &isRoot) const {
+    int n = vertices.size();
+    std::vector<int> res;
+    res.reserve(n);
+    if (order == VertexOrder::Insertion) {
+        for (int i = 0; i < n; i++)
+            res.push_back(i);
+        return res;
+    }
+
+    // Neighbours of every vertex, in compressed rows (edge counts can exceed the range of int)
+    std::vector<size_t> first(n + 1, 0);
+    std::vector<int> neighbours(2 * edges.size());
+    for (const PendingEdge &e : edges) {
+        first[e.orig + 1]++;
+        first[e.dest + 1]++;
+    }
+    for (int i = 0; i < n; i++)
+        first[i + 1] += first[i];
+    std::vector<size_t> next(first.begin(), first.end() - 1);
+    for (const PendingEdge &e : edges) {
+        neighbours[next[e.orig]++] = e.dest;
+        neighbours[next[e.dest]++] = e.orig;
+    }
+    auto degree = [&first](int v) { return first[v + 1] - first[v]; };
+
+    std::vector<bool> visited(n, false);
+    auto visit = [&](int s) {
+        std::queue<int> q;
+        q.push(s);
+        visited[s] = true;
+        while (!q.empty()) {
+            int v = q.front();
+            q.pop();
+            res.push_back(v);
+            size_t begin = res.size();
+            for (size_t i = first[v]; i < first[v + 1]; i++) {
+                int w = neighbours[i];
+                if (!visited[w]) {
+                    visited[w] = true;
+                    res.push_back(w);
+                }
+            }
+            // Cuthill-McKee visits the neighbours by increasing degree
+            if (order == VertexOrder::RCM)
+                std::stable_sort(res.begin() + begin, res.end(),
+                                 [&degree](int a, int b) { return degree(a) < degree(b); });
+            for (size_t i = begin; i < res.size(); i++)
+                q.push(res[i]);
+            res.resize(begin);
+        }
+    };
+
+    if (order == VertexOrder::BFS) {
+        if (isRoot != nullptr)
+            for (int i = 0; i < n; i++)
+                if (!visited[i] && isRoot(vertices[i].first))
+                    visit(i);
+        for (int i = 0; i < n; i++)
+            if (!visited[i])
+                visit(i);
+    }
+    else {
+        // each component starts at one of its vertices with the lowest degree
+        std::vector<int> byDegree(n);
+        for (int i = 0; i < n; i++)
+            byDegree[i] = i;
+        std::stable_sort(byDegree.begin(), byDegree.end(),
+                         [&degree](int a, int b) { return degree(a) < degree(b); });
+        for (int v : byDegree)
+            if (!visited[v])
+                visit(v);
+        std::reverse(res.begin(), res.end());
+    }
+    return res;
+}
+
+template <class T, class Hash>
+void GraphBuilder<T, Hash>::build(VertexOrder order, const std::function<bool(const T &)> &isRoot) {
+    if (built)
+        return;
+    built = true;
+
+    // First pass: degrees and total number of edges
+    size_t n = vertices.size();
+    std::vector<size_t> outdegree(n, 0), indegree(n, 0);
+    size_t numEdges = 0;
+    for (const PendingEdge &e : edges) {
+        outdegree[e.orig]++;
+        indegree[e.dest]++;
+        numEdges++;
+        if (e.direction == Direction::Bidirectional) {
+            outdegree[e.dest]++;
+            indegree[e.orig]++;
+            numEdges++;
+        }
+    }
+
+    // Second pass: one block per array, exact adjacency sizes
+    if (n > 0) {
+        createdVertices = std::allocator<Vertex<T>>().allocate(n);
+        graph.vertexPools.emplace_back(createdVertices, n);
+    }
+    std::vector<int> layout = computeOrder(order, isRoot);
+    position.assign(n, 0);
+    graph.vertexSet.reserve(graph.vertexSet.size() + n);
+    for (size_t k = 0; k < n; k++) {
+        int i = layout[k];
+        position[i] = k;
+        auto v = new (createdVertices + k) Vertex<T>(vertices[i].first, vertices[i].second);
+        v->pooled = true;
+        v->adj.reserve(outdegree[i]);
+        v->incoming.reserve(indegree[i]);
+        graph.vertexSet.push_back(v);
+    }
+
+    // Edges sorted by the position of their source vertex (counting sort)
+    std::vector<size_t> start(n + 1, 0);
+    for (const PendingEdge &e : edges)
+        start[position[e.orig] + 1]++;
+    for (size_t k = 0; k < n; k++)
+        start[k + 1] += start[k];
+    std::vector<size_t> sorted(edges.size());
+    for (size_t i = 0; i < edges.size(); i++)
+        sorted[start[position[edges[i].orig]]++] = i;
+
+    Edge<T> *pool = nullptr;
+    if (numEdges > 0) {
+        pool = std::allocator<Edge<T>>().allocate(numEdges);
+        graph.edgePools.emplace_back(pool, numEdges);
+    }
+    createdEdges.assign(edges.size(), nullptr);
+    Edge<T> *next = pool;
+    auto wire = [&next](Vertex<T> *orig, Vertex<T> *dest, double w) {
+        auto edge = new (next++) Edge<T>(orig, dest, w);
+        edge->pooled = true;
+        orig->adj.push_back(edge);
+        dest->incoming.push_back(edge);
+        return edge;
+    };
+    for (size_t i : sorted) {
+        const PendingEdge &e = edges[i];
+        Vertex<T> *orig = createdVertices + position[e.orig];
+        Vertex<T> *dest = createdVertices + position[e.dest];
+        Edge<T> *e1 = wire(orig, dest, e.weight);
+        e1->undirected = e.direction == Direction::Undirected;
+        if (e.direction == Direction::Bidirectional) {
+            Edge<T> *e2 = wire(dest, orig, e.weight);
+            e1->setReverse(e2);
+            e2->setReverse(e1);
+        }
+        createdEdges[i] = e1;
+    }
+}
+
+template <class T, class Hash>
+Vertex<T> *GraphBuilder<T, Hash>::getVertex(int i) const {
+    return createdVertices + position[i];
+}
+
+template <class T, class Hash>
+Edge<T> *GraphBuilder<T, Hash>::getEdge(size_t i) const {
+    return createdEdges[i];
+}
+
+#endif /* DA_TP_CLASSES_GRAPH_BUILDER */
@@ -7,23 +7,33 @@
 #include <iostream>
 #include <fstream>
 #include <filesystem>
+#include <memory>
 
 #include "src/Utils.h"
 #include "src/data/Data.h"
+#include "src/data/Snapshot.h"
 #include "src/CSV.h"
 #include "src/Parser.h"
 #include "src/Runtime.h"
 
 
-void printError() {
+[[noreturn]] void printError() {
   // TODO
   std::cerr
-      << "USAGE: DA2324_PRJ1_G163 <path>\n"
+      << "USAGE: DA2324_PRJ1_G163 <path> [--save-snapshot <file>] [--order insertion|bfs|rcm]\n"
+      << "       [--solver auto|edmonds-karp|boykov-kolmogorov]\n"
       << "       being <path> the folder in which the following csv files are located:\n"
       << "        - Cities.csv\n"
       << "        - Pipes.csv\n"
       << "        - Reservoir.csv\n"
       << "        - Stations.csv\n"
+      << "       (optionally compressed as .csv.gz or .csv.zst)\n"
+      << "       or a snapshot file previously written with --save-snapshot.\n"
+      << "       --order lays out the network in memory in csv order (default), breadth-first\n"
+      << "       order from the reservoirs or reverse Cuthill-McKee order.\n"
+      << "       --solver chooses the max-flow engine (default edmonds-karp); auto times\n"
+      << "       every engine on the network and keeps the fastest.\n"
+      << "       Options may also be written as --option=value.\n"
       << "See the Doxygen documentation for more information."
       << std::endl;
   std::exit(1);
@@ -37,6 +47,10 @@ std::vector<std::string> getCSVPaths(std::string path) {
     std::string filePath = file.path().string();
     for (int i = 0; i < 4; ++i) {
       if (filePath.find(expectedFiles[i]) != std::string::npos && filePath.find(".csv") != std::string::npos) {
+        if (!ChunkReader::isSupported(filePath)) {
+          warning("Ignoring " + filePath + ": compression not supported by this build");
+          continue;
+        }
         if (paths[i] != "") {
           error("Found multiple " + expectedFiles[i] + " files");
           printError();
@@ -58,30 +72,99 @@ std::vector<std::string> getCSVPaths(std::string path) {
 std::vector<Csv> parseCSVs(std::vector<std::string> paths) {
   std::vector<Csv> csv;
   for (const std::string& path: paths) {
-    std::ifstream file(path);
-    std::string fileContent((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    auto p = parse_csv()(fileContent);
+    ChunkReader reader(path);
+    size_t failed = 0;
+    std::optional<Csv> p = parse_csv_stream(reader, failed);
+    std::string readError = reader.getError();
+    if (!readError.empty()) {
+      error(readError);
+      printError();
+    }
+    if (failed != 0) {
+      error("Failed to parse line " + std::to_string(failed) + " of the csv file " + path);
+      printError();
+    }
     if (!p.has_value()) {
       error("Failed to parse the csv file " + path);
       printError();
     }
-    auto [rest, v] = p.value();
-    csv.push_back(v);
+    csv.push_back(std::move(p.value()));
   }
   return csv;
 }
 
-int main(int argc, char **argv) {
-  if (argc != 2) printError();
-  if (!std::filesystem::is_directory(argv[1])) {
-    error("The path provided is not a directory (" + std::string(argv[1]) + ")");
+std::unique_ptr<Data> loadData(const std::string &path, VertexOrder order) {
+  if (std::filesystem::is_directory(path)) {
+    std::vector<std::string> paths = getCSVPaths(path);
+    std::vector<Csv> csv = parseCSVs(paths);
+    return std::make_unique<Data>(csv[0], csv[1], csv[2], csv[3], order);
+  }
+  if (std::filesystem::is_regular_file(path) && Snapshot::isSnapshot(path)) {
+    Snapshot snapshot(path);
+    return std::make_unique<Data>(snapshot, order);
+  }
+  error("The path provided is not a directory nor a snapshot (" + path + ")");
+  printError();
+}
+
+VertexOrder parseOrder(const std::string &order) {
+  if (order == "insertion")
+    return VertexOrder::Insertion;
+  if (order == "bfs")
+    return VertexOrder::BFS;
+  if (order == "rcm")
+    return VertexOrder::RCM;
+  error("Unknown vertex order " + order);
+  printError();
+}
+
+std::optional<Solver> parseSolverOption(const std::string &name) {
+  if (name == "auto")
+    return std::nullopt;
+  std::optional<Solver> solver = parseSolver(name);
+  if (!solver.has_value()) {
+    error("Unknown solver " + name);
     printError();
   }
+  return solver;
+}
 
-  std::vector<std::string> paths = getCSVPaths(argv[1]);
-  std::vector<Csv> csv = parseCSVs(paths);
+int main(int argc, char **argv) {
+  if (argc < 2) printError();
+  std::string snapshotPath;
+  VertexOrder order = VertexOrder::Insertion;
+  std::optional<Solver> solver = Solver::EdmondsKarp;
+  for (int i = 2; i < argc; i++) {
+    std::string option = argv[i], value;
+    if (size_t eq = option.find('='); eq != std::string::npos) {
+      value = option.substr(eq + 1);
+      option.resize(eq);
+    } else if (i + 1 < argc) {
+      value = argv[++i];
+    } else {
+      printError();
+    }
+    if (option == "--save-snapshot")
+      snapshotPath = value;
+    else if (option == "--order")
+      order = parseOrder(value);
+    else if (option == "--solver")
+      solver = parseSolverOption(value);
+    else
+      printError();
+  }
+
+  std::unique_ptr<Data> d = loadData(argv[1], order);
+  d->setSolver(solver);
+
+  if (!snapshotPath.empty()) {
+    if (!Snapshot::write(snapshotPath, *d)) {
+      error("Failed to write the snapshot " + snapshotPath);
+      printError();
+    }
+    info("Snapshot written to " + snapshotPath);
+  }
 
-  Data d(csv[0], csv[1], csv[2], csv[3]);
-  Runtime rt(&d);
+  Runtime rt(d.get());
   rt.run();
 }
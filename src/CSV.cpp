@@ -25,9 +25,9 @@ Parser<CsvValues> parse_flt() {
 }
 
 Parser<CsvValues> parse_str() {
-  auto fst = verifies([](auto c) { return c != ',' && c != '\n'; });
+  auto fst = verifies([](auto c) { return c != ',' && c != '\n' && c != '\r'; });
   auto snd =
-      verifies([](auto c) { return c != ',' && c != '\n'; }).take_while();
+      verifies([](auto c) { return c != ',' && c != '\n' && c != '\r'; }).take_while();
   auto final = fst.pair(snd).recognize().pmap<CsvValues>(
       [](auto inp) { return CsvValues::Str(inp); });
   return final;
@@ -59,29 +59,42 @@ Parser<CsvValues> parse_weird() {
 }
 
 Parser<CsvLine> parse_line() {
-  auto parse_BOM = string_p("\xEF\xBB\xBF").pmap<CsvValues>([](auto c) {
-    return CsvValues::Sep();
-  });
   auto parse_value = alt(std::vector<Parser<CsvValues>>(
-      {parse_BOM, parse_flt(), parse_int(), parse_weird(), parse_str()}));
+      {parse_flt(), parse_int(), parse_weird(), parse_str()}));
   auto parse_sep =
       char_p(',').pmap<CsvValues>([](auto p) { return CsvValues::Sep(); });
-  return alt(std::vector<Parser<CsvValues>>({parse_sep, parse_value}))
+  auto parse_fields = alt(std::vector<Parser<CsvValues>>({parse_sep, parse_value}))
       .take_while()
       .ends_with_fst(alt(std::vector(
           {string_p("\r\n"), string_p("\n\r"),
            string_p("\n"), string_p("\r")}))) // Windows, RISCOS, Unix, Legacy MacOs
       .pmap<CsvLine>([](auto p) {
         CsvLine res;
+        // an empty field keeps its column, as a None value
+        bool empty = true, filled = false;
         for (CsvValues r : p) {
           if (r.variant == CsvValues::None)
             return CsvLine();
-          if (r.variant == CsvValues::Separator)
+          if (r.variant == CsvValues::Separator) {
+            if (!filled)
+              res.add_val(CsvValues::Nil());
+            filled = false;
             continue;
+          }
           res.add_val(r);
+          empty = false;
+          filled = true;
         }
-        return res;
+        // so does a trailing empty field (the line ends with a separator)
+        if (!p.empty() && !filled)
+          res.add_val(CsvValues::Nil());
+        return empty ? CsvLine() : res;
       });
+  auto parse_BOM = string_p("\xEF\xBB\xBF").pair(parse_fields).pmap<CsvLine>([](auto p) {
+    auto [bom, line] = p;
+    return line;
+  });
+  return alt(std::vector<Parser<CsvLine>>({parse_BOM, parse_fields}));
 }
 
 Parser<Csv> parse_csv() {
@@ -91,6 +104,55 @@ Parser<Csv> parse_csv() {
   });
 }
 
+std::optional<Csv> parse_csv_stream(ChunkReader &reader, size_t &failed) {
+  Parser<CsvLine> line_p = parse_line();
+  std::optional<CsvLine> header;
+  std::vector<CsvLine> data;
+  size_t number = 0;
+  failed = 0;
+  auto consume = [&](const std::string &line) {
+    number++;
+    auto p = line_p(line);
+    if (!p.has_value()) {
+      failed = number;
+      return;
+    }
+    auto [rest, v] = p.value();
+    if (!header.has_value())
+      header = v;
+    else
+      data.push_back(v);
+  };
+
+  // a line ends with "\r\n", "\n\r", "\n" or "\r", like in parse_line(), so a '\r' or
+  // '\n' at the end of the buffer waits for the next chunk, which may hold the other half
+  std::string chunk, buffer;
+  bool more = true;
+  while (failed == 0 && more) {
+    more = reader.next(chunk);
+    if (more)
+      buffer.append(chunk);
+    size_t start = 0;
+    for (size_t end = buffer.find_first_of("\r\n"); end != std::string::npos && failed == 0;
+         end = buffer.find_first_of("\r\n", start)) {
+      size_t next = end + 1;
+      if (next == buffer.size() && more)
+        break;
+      if (next < buffer.size() && (buffer[next] == '\r' || buffer[next] == '\n') && buffer[next] != buffer[end])
+        next++;
+      consume(buffer.substr(start, next - start));
+      start = next;
+    }
+    buffer.erase(0, start);
+  }
+  if (failed == 0 && !buffer.empty())
+    consume(buffer + '\n');
+
+  if (failed != 0 || !header.has_value())
+    return {};
+  return Csv(header.value(), std::move(data));
+}
+
 std::optional<std::string> CsvValues::get_str() {
   if (variant != String) {
     return {};
@@ -1,5 +1,6 @@
 #ifndef CSV_H
 #define CSV_H 
+#include "ChunkReader.h"
 #include "Parser.h"
 #include <cstddef>
 #include <cstdint>
@@ -153,6 +154,17 @@ Parser<CsvLine> parse_line();
   */ 
 Parser<Csv> parse_csv();
 
+/*
+  * @brief Parses a Csv file line by line, as its chunks are read.
+  * @details Only the current chunk and line are kept in memory. The lines can end
+  * like in parse_line(), even across chunks.
+  * @param failed: Set to the number of the first line that cannot be parsed (the
+  * header is line 1), or to 0.
+  * @return The parsed Csv, or nothing if a line could not be parsed or the file is empty.
+  * @note O(N) where N is the size of the file.
+  */
+std::optional<Csv> parse_csv_stream(ChunkReader &reader, size_t &failed);
+
 /*
   * @brief Parses a floating point number.
   * @return Parser<CsvValues>
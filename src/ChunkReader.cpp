@@ -0,0 +1,197 @@
+#include "ChunkReader.h"
+#include <fstream>
+#include <vector>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+static bool endsWith(const std::string &s, const std::string &suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+ChunkReader::ChunkReader(std::string path) : path(std::move(path)) {
+  worker = std::thread(&ChunkReader::produce, this);
+}
+
+ChunkReader::~ChunkReader() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    cancelled = true;
+  }
+  changed.notify_all();
+  worker.join();
+}
+
+bool ChunkReader::next(std::string &chunk) {
+  std::unique_lock<std::mutex> lock(mutex);
+  changed.wait(lock, [this] { return !filled.empty() || done; });
+  if (filled.empty())
+    return false;
+  chunk.clear();
+  spare.push_back(std::move(chunk));
+  chunk = std::move(filled.front());
+  filled.pop_front();
+  lock.unlock();
+  changed.notify_all();
+  return true;
+}
+
+std::string ChunkReader::getError() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return error;
+}
+
+bool ChunkReader::isSupported(const std::string &path) {
+#ifndef HAVE_ZLIB
+  if (endsWith(path, ".gz"))
+    return false;
+#endif
+#ifndef HAVE_ZSTD
+  if (endsWith(path, ".zst"))
+    return false;
+#endif
+  return true;
+}
+
+void ChunkReader::produce() {
+  if (endsWith(path, ".gz"))
+    readGzip();
+  else if (endsWith(path, ".zst"))
+    readZstd();
+  else
+    readPlain();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+  }
+  changed.notify_all();
+}
+
+std::string ChunkReader::takeBuffer() {
+  std::unique_lock<std::mutex> lock(mutex);
+  changed.wait(lock, [this] { return filled.size() < MAX_CHUNKS || cancelled; });
+  std::string buffer;
+  if (!spare.empty()) {
+    buffer = std::move(spare.front());
+    spare.pop_front();
+  }
+  buffer.resize(CHUNK_SIZE);
+  return buffer;
+}
+
+bool ChunkReader::push(std::string &&buffer) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (cancelled)
+      return false;
+    filled.push_back(std::move(buffer));
+  }
+  changed.notify_all();
+  return true;
+}
+
+void ChunkReader::readPlain() {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    std::lock_guard<std::mutex> lock(mutex);
+    error = "Could not open " + path;
+    return;
+  }
+  while (file) {
+    std::string buffer = takeBuffer();
+    file.read(buffer.data(), CHUNK_SIZE);
+    buffer.resize(file.gcount());
+    if (buffer.empty() || !push(std::move(buffer)))
+      return;
+  }
+}
+
+void ChunkReader::readGzip() {
+#ifdef HAVE_ZLIB
+  gzFile file = gzopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    std::lock_guard<std::mutex> lock(mutex);
+    error = "Could not open " + path;
+    return;
+  }
+  gzbuffer(file, CHUNK_SIZE);
+  while (true) {
+    std::string buffer = takeBuffer();
+    int n = gzread(file, buffer.data(), CHUNK_SIZE);
+    // a truncated file ends with a short read and Z_BUF_ERROR, not with a negative count
+    int code = Z_OK;
+    const char *message = gzerror(file, &code);
+    if (n < 0 || code != Z_OK || (n == 0 && !gzeof(file))) {
+      std::lock_guard<std::mutex> lock(mutex);
+      error = "Failed to decompress " + path + " (truncated or corrupt file): " + message;
+      break;
+    }
+    buffer.resize(n);
+    if (n == 0 || !push(std::move(buffer)))
+      break;
+  }
+  gzclose(file);
+#else
+  std::lock_guard<std::mutex> lock(mutex);
+  error = "This build does not support gzip files (" + path + ")";
+#endif
+}
+
+void ChunkReader::readZstd() {
+#ifdef HAVE_ZSTD
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    std::lock_guard<std::mutex> lock(mutex);
+    error = "Could not open " + path;
+    return;
+  }
+  ZSTD_DStream *stream = ZSTD_createDStream();
+  std::vector<char> compressed(ZSTD_DStreamInSize());
+  ZSTD_inBuffer in = {compressed.data(), 0, 0};
+  std::string buffer = takeBuffer();
+  ZSTD_outBuffer out = {buffer.data(), CHUNK_SIZE, 0};
+  bool stopped = false, eof = false;
+  size_t ret = 1; // 0 once a frame is complete and fully flushed (an empty file has no frame)
+  while (true) {
+    if (in.pos == in.size && !eof) {
+      file.read(compressed.data(), compressed.size());
+      in = {compressed.data(), static_cast<size_t>(file.gcount()), 0};
+      eof = in.size == 0;
+    }
+    if (eof && ret == 0)
+      break; // everything was flushed
+    ret = ZSTD_decompressStream(stream, &out, &in);
+    if (ZSTD_isError(ret)) {
+      std::lock_guard<std::mutex> lock(mutex);
+      error = "Failed to decompress " + path + ": " + ZSTD_getErrorName(ret);
+      break;
+    }
+    if (out.pos == out.size) {
+      if (!push(std::move(buffer))) {
+        stopped = true;
+        break;
+      }
+      buffer = takeBuffer();
+      out = {buffer.data(), CHUNK_SIZE, 0};
+    } else if (eof && ret != 0) {
+      // no input is left, but the frame still expects some
+      std::lock_guard<std::mutex> lock(mutex);
+      error = "Failed to decompress " + path + " (truncated or corrupt file): incomplete frame";
+      break;
+    }
+  }
+  if (!stopped && out.pos > 0) {
+    buffer.resize(out.pos);
+    push(std::move(buffer));
+  }
+  ZSTD_freeDStream(stream);
+#else
+  std::lock_guard<std::mutex> lock(mutex);
+  error = "This build does not support zstd files (" + path + ")";
+#endif
+}
@@ -0,0 +1,94 @@
+#ifndef DA2324_PRJ1_G163_CHUNKREADER_H
+#define DA2324_PRJ1_G163_CHUNKREADER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * @brief Streaming reader of (possibly compressed) files.
+ * @details The file is read on a separate thread, decompressed if needed, and
+ * handed to the consumer in chunks of at most ChunkReader::CHUNK_SIZE bytes.
+ * At most ChunkReader::MAX_CHUNKS chunks are buffered at the same time, so the
+ * whole file is never held in memory and decompression overlaps with whatever
+ * the consumer does with the previous chunks.\n
+ * The compression is detected from the extension of the file:
+ * - `.gz`: gzip (requires zlib);
+ * - `.zst`: zstd (requires libzstd);
+ * - anything else is read as is.
+ */
+class ChunkReader {
+public:
+  /// Maximum size of a chunk
+  static constexpr size_t CHUNK_SIZE = 64 * 1024;
+  /// Maximum number of chunks waiting to be consumed
+  static constexpr size_t MAX_CHUNKS = 4;
+
+  /**
+   * @brief Opens the file and starts reading it in the background.
+   * @param path: Path to the file.
+   */
+  explicit ChunkReader(std::string path);
+  ~ChunkReader();
+  ChunkReader(const ChunkReader &) = delete;
+  ChunkReader &operator=(const ChunkReader &) = delete;
+
+  /**
+   * @brief Waits for the next chunk.
+   * @details The previous content of chunk is recycled as a buffer for the
+   * reading thread.
+   * @param chunk: Replaced with the next chunk of the file.
+   * @return false when the end of the file was reached (or reading failed).
+   */
+  bool next(std::string &chunk);
+
+  /**
+   * @brief Error that stopped the reading thread.
+   * @return An empty string if the file was read successfully.
+   */
+  std::string getError();
+
+  /**
+   * @brief Checks if the compression of a file (detected by its extension) is
+   * supported by this build.
+   */
+  static bool isSupported(const std::string &path);
+
+private:
+  /// Path of the file being read
+  std::string path;
+  /// Reading thread
+  std::thread worker;
+  /// Protects every field below
+  std::mutex mutex;
+  /// Signaled when a chunk is produced or consumed
+  std::condition_variable changed;
+  /// Chunks ready to be consumed
+  std::deque<std::string> filled;
+  /// Buffers already consumed, reused by the reading thread
+  std::deque<std::string> spare;
+  /// True when the reading thread finished
+  bool done = false;
+  /// True when the consumer is no longer interested in the file
+  bool cancelled = false;
+  /// Reason why reading failed
+  std::string error;
+
+  /// Body of the reading thread
+  void produce();
+  /// Gets an empty buffer to fill
+  std::string takeBuffer();
+  /// Hands a filled buffer to the consumer, returns false if cancelled
+  bool push(std::string &&buffer);
+  /// Reads a plain file
+  void readPlain();
+  /// Reads a gzip file
+  void readGzip();
+  /// Reads a zstd file
+  void readZstd();
+};
+
+#endif // DA2324_PRJ1_G163_CHUNKREADER_H
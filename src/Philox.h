@@ -0,0 +1,49 @@
+#ifndef DA2324_PRJ1_G163_PHILOX_H
+#define DA2324_PRJ1_G163_PHILOX_H
+
+#include <array>
+#include <cstdint>
+
+/**
+ * @brief Philox4x32-10 counter-based random number generator (Salmon et al., "Parallel random numbers: as easy as
+ * 1, 2, 3").
+ * @details There is no state to advance: the random numbers are a function of a 128-bit counter and of the
+ * seed. Every draw can be named by its own counter (for example, the sample and the index of the draw in the
+ * sample), so the numbers do not depend on which thread draws them or in which order.
+ */
+class Philox {
+public:
+  using Counter = std::array<uint32_t, 4>;
+
+  explicit Philox(uint64_t seed) : key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)} {}
+
+  /// Four random 32-bit words for a counter
+  Counter operator()(Counter counter) const {
+    std::array<uint32_t, 2> k = key;
+    for (int round = 0; round < 10; round++) {
+      uint64_t p0 = static_cast<uint64_t>(M0) * counter[0], p1 = static_cast<uint64_t>(M1) * counter[2];
+      counter = {static_cast<uint32_t>(p1 >> 32) ^ counter[1] ^ k[0], static_cast<uint32_t>(p1),
+                 static_cast<uint32_t>(p0 >> 32) ^ counter[3] ^ k[1], static_cast<uint32_t>(p0)};
+      k[0] += W0;
+      k[1] += W1;
+    }
+    return counter;
+  }
+
+  /// Two uniform numbers in (0, 1] with 53 random bits each, for a counter
+  std::array<double, 2> uniform(Counter counter) const {
+    Counter words = (*this)(counter);
+    auto toUnit = [](uint32_t high, uint32_t low) {
+      uint64_t bits = (static_cast<uint64_t>(high) << 32 | low) >> 11;
+      return static_cast<double>(bits + 1) * 0x1p-53;
+    };
+    return {toUnit(words[0], words[1]), toUnit(words[2], words[3])};
+  }
+
+private:
+  static constexpr uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+  static constexpr uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+  std::array<uint32_t, 2> key;
+};
+
+#endif // DA2324_PRJ1_G163_PHILOX_H
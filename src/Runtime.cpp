@@ -1,6 +1,7 @@
 #include "Runtime.h"
 #include "Parser.h"
 #include "Utils.h"
+#include <algorithm>
 #include <cstdint>
 #include <exception>
 #include <iomanip>
@@ -13,6 +14,15 @@
 
 Runtime::Runtime(Data *d) { this->data = d; }
 
+/// Service points of a pipe, in code order if it is bidirectional
+static std::pair<NodeCode, NodeCode> pipeEnds(const Edge<Info> *e) {
+  NodeCode codeA = e->getOrig()->getInfo().getCode();
+  NodeCode codeB = e->getDest()->getInfo().getCode();
+  if (e->isUndirected() && codeB < codeA) // order the pair
+    std::swap(codeA, codeB);
+  return {codeA, codeB};
+}
+
 [[noreturn]] void Runtime::run() {
   std::cout << "Welcome to Water Supply Management.\n"
             << "Type 'help' to learn more.\n";
@@ -48,10 +58,22 @@ void Runtime::printHelp() {
       << comment << "      Number of cities, reservoirs and pumps. Useful for debug.\n"
       << keyword << "  maxFlowCity [city_id]\n"
       << comment << "      Maximum amount of water that can reach each or a specific city.\n"
-      << keyword << "  needsMet\n"
-      << comment << "      Cities with not enough flow for their demand.\n"
+      << keyword << "  needsMet [--explain]\n"
+      << comment << "      Cities with not enough flow for their demand. With --explain, the saturated pipes, pumps and reservoirs that limit them.\n"
       << keyword << "  balanceGraph\n"
       << comment << "      Redistribution of the flow from edges with less remaining space to edges with more remaining space.\n"
+      << keyword << "  topPipes [k]\n"
+      << comment << "      The k (default 20) pipes whose removal loses the most water.\n"
+      << keyword << "  contingency [2|3] [k] [max_scenarios]\n"
+      << comment << "      The k (default 20) combinations of 2 (default) or 3 simultaneous failures of pipes, reservoirs and pumps that interact and lose the most water, worst first. Stops after solving max_scenarios (default 50000) scenarios.\n"
+      << keyword << "  simulate [failure] [max_samples] [seed]\n"
+      << comment << "      Expected unmet demand of each city when pipes and pumping stations fail at random, with 95% confidence intervals. Uses the Failure columns of Pipes.csv and Stations.csv, and failure (per mille, default 0) for the rest. Stops when the total is known within 1%, or after max_samples (default 100000) samples.\n"
+      << keyword << "  growth\n"
+      << comment << "      Water delivered as every city demand grows by the same factor: the breakpoints of the curve, and the largest growth met in full.\n"
+      << keyword << "  drought\n"
+      << comment << "      Water delivered as every reservoir shrinks to the same fraction of its capacity: the breakpoints of the curve, and how far the reservoirs can shrink before the delivery falls.\n"
+      << keyword << "  minCost\n"
+      << comment << "      The cheapest way of delivering the maximum flow, with the pumping cost per unit of water of each pipe (Cost column of Pipes.csv).\n"
       << keyword << "  rm\n"
       << keyword << "      reservoir [reservoir_id]\n"
       << comment << "          List the compromised cities if a reservoir, specific via the optional argument, can be removed, or, if empty, all that can be removed.\n"
@@ -75,23 +97,23 @@ void Runtime::handleCount() {
 }
 
 void Runtime::handleMaxFlowCity(std::vector<CommandLineValue> args) {
-  std::unordered_map<uint16_t, uint32_t> maxFlows = data->maxFlowCity();
+  std::unordered_map<uint32_t, uint32_t> maxFlows = data->maxFlowCity();
   if (!args.empty()) {
     if (!args[0].getInt().has_value()) {
       error("Invalid input in maxFlowCity");
     }
-    uint16_t citySelected = args[0].getInt().value();
+    uint32_t citySelected = args[0].getInt().value();
     if (!maxFlows.contains(citySelected)) {
       error("City id '" + std::to_string(args[0].getInt().value()) +
             "' not found.");
       return;
     }
-    std::cout << Utils::parseId(Info::Kind::City, citySelected) << ": "
+    std::cout << NodeCode(Info::Kind::City, citySelected) << ": "
               << maxFlows.at(citySelected) << '\n';
   } else {
-    uint32_t sumMaxFlow = 0;
+    uint64_t sumMaxFlow = 0;
     for (auto &maxFlow : maxFlows) {
-      std::cout << Utils::parseId(Info::Kind::City, maxFlow.first) << ": "
+      std::cout << NodeCode(Info::Kind::City, maxFlow.first) << ": "
                 << maxFlow.second << '\n';
       sumMaxFlow += maxFlow.second;
     }
@@ -103,22 +125,17 @@ void Runtime::handleMaxFlowCity(std::vector<CommandLineValue> args) {
 void Runtime::handleRmPump(std::vector<CommandLineValue> args) {
   if (args.empty()) {
     bool is_virgin = true;
-    for (auto vx : data->getGraph().getVertexSet()) {
-      if (vx->getInfo().getKind() == Info::Kind::Reservoir) {
-        auto res = data->removeSite(vx);
-        if (res.empty()) {
-          is_virgin = false;
-          std::cout << "If the pump " << vx->getInfo().getId()
-                    << " is removed, no changes are observed" << std::endl;
-        }
-      }
+    for (auto vx : data->removableSites(data->getPumps())) {
+      is_virgin = false;
+      std::cout << "If the pump " << vx->getInfo().getId()
+                << " is removed, no changes are observed" << std::endl;
     }
     if (is_virgin)
       warning("There is not any redundancy in the network!");
     return;
   }
   uint32_t id = args[0].getInt().value();
-  auto tgt = Utils::findVertex(data->getGraph(), Info::Kind::Pump, id);
+  auto tgt = Utils::findVertex(data->getGraph(), NodeCode(Info::Kind::Pump, id));
   if (tgt == nullptr)
     return;
   auto res = data->removeSite(tgt);
@@ -135,92 +152,47 @@ void Runtime::handleRmPump(std::vector<CommandLineValue> args) {
 }
 
 void Runtime::handleRmPipe(std::vector<CommandLineValue> args) {
-  std::unordered_map<uint16_t, uint32_t> maxFlows = data->maxFlowCity();
-  std::unordered_map<std::pair<std::string, std::string>,
-                     std::unordered_map<uint16_t, uint32_t>, pair_hash>
-      removingPipesImpact = data->removingPipes();
-
-  if (removingPipesImpact.empty()) {
-    error("No pipes found.\n");
-    return;
-  }
   if (args.size() == 2) {
-    Vertex<Info> *vertexA;
-    Vertex<Info> *vertexB;
-    std::string codeA;
-    std::string codeB;
+    NodeCode codeA;
+    NodeCode codeB;
     try {
-      codeA = args[0].getStr().value();
-      codeB = args[1].getStr().value();
-      auto parsedA = Utils::parseCode(codeA);
-      auto parsedB = Utils::parseCode(codeB);
-      vertexA =
-          Utils::findVertex(data->getGraph(), parsedA.first, parsedA.second);
-      vertexB =
-          Utils::findVertex(data->getGraph(), parsedB.first, parsedB.second);
+      codeA = args[0].getCode().value();
+      codeB = args[1].getCode().value();
     } catch (const std::exception &e) {
       error("Invalid codes");
       return;
     }
 
-    std::pair<std::string, std::string> pipeId = std::make_pair(codeA, codeB);
-    auto it = removingPipesImpact.find(pipeId);
-
-    if (it == removingPipesImpact.end()) {
-      info("The key " + codeA + " to " + codeB + " was not found.");
-      auto edge = Utils::findEdge(vertexA, vertexB);
-      if (edge != nullptr) {
-        if (edge->getReverse() != nullptr) { // the edge is bidirectional
-          info("Bidirectional edge found. Trying reverse order.");
-          pipeId = std::make_pair(codeB, codeA);
-          it = removingPipesImpact.find(pipeId);
-        }
-      } else
-        error("Pipeline between " + codeA + " and " + codeB + " not found.");
+    uint32_t pipe = data->findPipe(codeA, codeB);
+    if (pipe == PipeIndex::NONE) {
+      error("Pipeline between " + codeA.toString() + " and " + codeB.toString() + " not found.");
+      return;
     }
-    if (it != removingPipesImpact.end()) {
-      std::cout << "Impact of removing Pipeline from " << codeA << " to "
-                << codeB << ":\n";
-      std::cout << "City | Old Flow | New Flow | Difference\n";
-      for (const auto &cityFlow : it->second) {
-        auto cityId = cityFlow.first;
-        auto newFlow = cityFlow.second;
-        auto itCity = std::find_if(
-            maxFlows.begin(), maxFlows.end(),
-            [cityId](const auto &pair) { return pair.first == cityId; });
-        int difference = newFlow - itCity->second;
-        if (difference != 0)
-          std::cout << std::setw(4)
-                    << Utils::parseId(Info::Kind::City, cityFlow.first)
-                    << std::setw(0) << " |" << std::setw(9) << itCity->second
-                    << std::setw(0) << " |" << std::setw(9) << cityFlow.second
-                    << std::setw(0) << " |" << std::setw(10) << std::showpos << difference
-                    << std::endl;
-      }
+
+    std::cout << "Impact of removing Pipeline from " << codeA << " to "
+              << codeB << ":\n";
+    std::cout << "City | Old Flow | New Flow | Difference\n";
+    for (const auto &[cityId, oldFlow, newFlow] : data->removingPipe(pipe)) {
+      int difference = static_cast<int>(newFlow) - static_cast<int>(oldFlow);
+      std::cout << std::setw(4)
+                << NodeCode(Info::Kind::City, cityId)
+                << std::setw(0) << " |" << std::setw(9) << oldFlow
+                << std::setw(0) << " |" << std::setw(9) << newFlow
+                << std::setw(0) << " |" << std::setw(10) << std::showpos << difference
+                << std::noshowpos << std::endl;
     }
   } else if (args.empty()) {
-    int removablePipesCount = 0;
+    if (data->getPipeCount() == 0) {
+      error("No pipes found.\n");
+      return;
+    }
     std::cout << "Removable pipelines without impact:\n";
-    for (const auto &[pipeId, cityFlows] : removingPipesImpact) {
-      bool affectsFlow = false;
-      for (const auto &cityFlow : cityFlows) {
-        auto cityId = cityFlow.first;
-        auto newFlow = cityFlow.second;
-
-        // Find original flow
-        unsigned int oldFlow = maxFlows[cityId];
-        if (newFlow != oldFlow) {
-          // at least one city was affected
-          affectsFlow = true;
-          break;
-        }
-      }
-      if (!affectsFlow) {
-        std::cout << pipeId.first << " to " << pipeId.second << '\n';
-        ++removablePipesCount;
-      }
+    std::vector<uint32_t> removable = data->removablePipes();
+    for (uint32_t pipe : removable) {
+      auto [codeA, codeB] = pipeEnds(data->getPipe(pipe));
+      std::cout << codeA << " to " << codeB << '\n';
     }
-    std::cout << "Found " << removablePipesCount
+    std::cout << "Found " << removable.size()
               << " pipelines that won't affect the flow.\n";
   } else {
     std::cerr << "ERROR: Command 'removingPipes' requires either no "
@@ -232,22 +204,17 @@ void Runtime::handleRmPipe(std::vector<CommandLineValue> args) {
 void Runtime::handleRmReservoir(std::vector<CommandLineValue> args) {
   if (args.empty()) {
     bool is_virgin = true;
-    for (auto vx : data->getGraph().getVertexSet()) {
-      if (vx->getInfo().getKind() == Info::Kind::Reservoir) {
-        auto res = data->removeSite(vx);
-        if (res.empty()) {
-          is_virgin = false;
-          std::cout << "If the reservoir " << vx->getInfo().getId()
-            << " is removed, no changes are observed" << std::endl;
-        }
-      }
+    for (auto vx : data->removableSites(data->getReservoirs())) {
+      is_virgin = false;
+      std::cout << "If the reservoir " << vx->getInfo().getId()
+        << " is removed, no changes are observed" << std::endl;
     }
     if (is_virgin)
       warning("There is not any redundancy in the network!");
     return;
   }
   uint32_t id = args[0].getInt().value();
-  auto tgt = Utils::findVertex(data->getGraph(), Info::Kind::Reservoir, id);
+  auto tgt = Utils::findVertex(data->getGraph(), NodeCode(Info::Kind::Reservoir, id));
   if (tgt == nullptr) 
     return;
   auto res = data->removeSite(tgt);
@@ -263,7 +230,7 @@ void Runtime::handleRmReservoir(std::vector<CommandLineValue> args) {
   }
 }
 
-void Runtime::handleNeedsMet() {
+void Runtime::handleNeedsMet(std::vector<CommandLineValue> args) {
   auto result = data->meetsWaterNeeds();
   if (result.empty())
     std::cout << "This network configuration meets the water needs of its "
@@ -271,20 +238,200 @@ void Runtime::handleNeedsMet() {
   else
     std::cout << "Cities with not enough flow for their demand:\n";
   for (const auto &pair : result) {
-    std::cout << Utils::parseId(Info::Kind::City, pair.first.getId()) << ": "
+    std::cout << pair.first.getCode() << " ("
+              << StringPool::global().view(pair.first.getLocationId()) << "): "
               << (pair.second * (-1))
               << " (Flow: " << pair.first.getCap().value() - pair.second << '/'
               << pair.first.getCap().value() << ")\n";
   }
-  return;
+  if (args.empty() || result.empty())
+    return;
+
+  std::cout << "Bottlenecks:\n";
+  for (const Bottleneck &b : data->explainDeficits()) {
+    for (size_t i = 0; i < b.cities.size(); i++)
+      std::cout << (i == 0 ? "" : ", ") << b.cities[i]->getInfo().getCode();
+    std::cout << ": at most " << b.capacity << " can reach "
+              << (b.cities.size() == 1 ? "it" : "them");
+    for (size_t i = 0; i < b.sharedWith.size(); i++)
+      std::cout << (i == 0 ? " (shared with " : ", ") << b.sharedWith[i]->getInfo().getCode();
+    std::cout << (b.sharedWith.empty() ? "\n" : ")\n");
+    for (const auto &pipe : b.pipes)
+      std::cout << "  Pipe " << pipe.from->getInfo().getCode() << " -> "
+                << pipe.to->getInfo().getCode() << " full (" << pipe.capacity << ")\n";
+    for (const auto &[pump, limit] : b.pumps)
+      std::cout << "  Pump " << pump->getInfo().getCode() << " at its limit (" << limit << ")\n";
+    for (const auto &[reservoir, delivery] : b.reservoirs)
+      std::cout << "  Reservoir " << reservoir->getInfo().getCode() << " exhausted (" << delivery << ")\n";
+  }
 }
 
 void Runtime::handleBalanceGraph() {
     auto result = data->balanceGraph();
-    std::cout << "Average: " << std::get<0>(result.first) << " -> " << std::get<0>(result.second) << '\n';
-    std::cout << "Variance: " << std::get<1>(result.first) << " -> " << std::get<1>(result.second) << '\n';
-    std::cout << "Max difference:" << std::get<2>(result.first) << " -> " << std::get<2>(result.second) << '\n';
+    std::cout << "Average: " << result.first.avg << " -> " << result.second.avg << '\n';
+    std::cout << "Variance: " << result.first.variance << " -> " << result.second.variance << '\n';
+    std::cout << "Max difference:" << result.first.max << " -> " << result.second.max << '\n';
+    return;
+}
+
+void Runtime::handleTopPipes(std::vector<CommandLineValue> args) {
+  size_t k = args.empty() ? 20 : args[0].getInt().value();
+  if (k == 0) {
+    error("The number of pipes to rank must be at least 1.");
+    return;
+  }
+  size_t evaluated;
+  std::vector<std::pair<uint32_t, uint64_t>> top = data->topPipes(k, evaluated);
+  if (top.empty()) {
+    std::cout << "Removing any single pipe loses no water.\n";
+    return;
+  }
+  std::cout << "Pipes whose removal loses the most water:\n";
+  for (const auto &[pipe, lost] : top) {
+    auto [codeA, codeB] = pipeEnds(data->getPipe(pipe));
+    std::cout << codeA << " to " << codeB << ": -" << lost << '\n';
+  }
+  std::cout << "Evaluated " << evaluated << " of " << data->getPipeCount() << " pipes.\n";
+}
+
+void Runtime::handleContingency(std::vector<CommandLineValue> args) {
+  unsigned size = args.empty() ? 2 : args[0].getInt().value();
+  size_t k = args.size() < 2 ? 20 : args[1].getInt().value();
+  size_t budget = args.size() < 3 ? 50000 : args[2].getInt().value();
+  if (size != 2 && size != 3) {
+    error("Contingencies of " + std::to_string(size) + " failures are not supported (2 or 3).");
     return;
+  }
+  if (k == 0) {
+    error("The number of combinations to rank must be at least 1.");
+    return;
+  }
+  std::cout << "Combinations of " << size << " failures that lose the most water:\n";
+  size_t reported = 0;
+  uint64_t left;
+  size_t solved = data->contingencies(size, k, budget, [this, &reported](const Contingency &c) {
+    reported++;
+    const char *separator = "";
+    for (uint32_t pipe : c.pipes) {
+      auto [codeA, codeB] = pipeEnds(data->getPipe(pipe));
+      std::cout << separator << codeA << " to " << codeB;
+      separator = " + ";
+    }
+    for (const Vertex<Info> *site : c.sites) {
+      std::cout << separator << site->getInfo().getCode();
+      separator = " + ";
+    }
+    // reported as soon as it is found
+    std::cout << ": -" << c.lost << std::endl;
+  }, left);
+  if (left != 0)
+    warning("Stopped after " + std::to_string(solved) + " scenarios: the combinations not listed lose at most " +
+            std::to_string(left) + ".");
+  else if (reported == 0)
+    std::cout << "No combination loses more water than its failures apart.\n";
+  std::cout << "Solved " << solved << " scenarios.\n";
+}
+
+void Runtime::handleSimulate(std::vector<CommandLineValue> args) {
+  double failure = args.empty() ? 0 : args[0].getInt().value() / 1000.0;
+  size_t samples = args.size() < 2 ? 100000 : args[1].getInt().value();
+  uint64_t seed = args.size() < 3 ? 1 : args[2].getInt().value();
+  if (failure > 1) {
+    error("A failure probability cannot exceed 1000 per mille.");
+    return;
+  }
+  Reliability result = data->simulate(failure, samples, seed);
+  if (result.samples == 0) {
+    error("Nothing to simulate: no pipe or station can fail. Give a failure probability, or fill the Failure "
+          "columns of Pipes.csv and Stations.csv.");
+    return;
+  }
+  std::vector<size_t> cities;
+  for (size_t i = 0; i < result.expected.size(); i++)
+    if (result.expected[i] > 0)
+      cities.push_back(i);
+  std::stable_sort(cities.begin(), cities.end(),
+                   [&result](size_t a, size_t b) { return result.expected[a] > result.expected[b]; });
+  auto show = [](double water) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << water;
+    return out.str();
+  };
+  std::cout << "Expected unmet demand (95% confidence):\n";
+  for (size_t i : cities) {
+    const Info &info = data->getCities()[i]->getInfo();
+    std::cout << info.getCode() << " (" << StringPool::global().view(info.getLocationId()) << "): "
+              << show(result.expected[i]) << " +- " << show(result.margin[i])
+              << " (without failures: " << show(result.baseline[i]) << ")\n";
+  }
+  std::cout << "Total: " << show(result.total) << " +- " << show(result.totalMargin) << '\n';
+  if (!result.converged)
+    warning("Stopped after " + std::to_string(result.samples) + " samples before the total was known within 1%.");
+  std::cout << "Simulated " << result.samples << " samples (seed " << seed << ").\n";
+}
+
+/// Prints the breakpoints of a curve of Data::flowCurve(), with the factors as percentages
+static void printCurve(const std::vector<CurvePoint> &curve, const std::string &factorLabel) {
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(2);
+  for (const CurvePoint &point : curve)
+    out << "  " << factorLabel << ' ' << point.factor * 100 << "%: " << point.flow << '\n';
+  std::cout << out.str();
+}
+
+void Runtime::handleGrowth() {
+  std::vector<CurvePoint> curve = data->flowCurve(Scaling::Demand);
+  if (curve.size() < 2) {
+    std::cout << "No city can receive water.\n";
+    return;
+  }
+  double demand = 0;
+  for (const Vertex<Info> *city : data->getCities())
+    if (city->getInfo().isActive())
+      demand += city->getInfo().getCap().value();
+  std::cout << "Water delivered with every demand at a percentage of its value (linear between the lines):\n";
+  printCurve(curve, "demand at");
+  const CurvePoint &first = curve[1], &last = curve.back();
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(2);
+  if (first.flow >= first.factor * demand * (1 - 1e-9))
+    out << "Every demand is met up to " << first.factor * 100 << "% of its value.\n";
+  else
+    out << "Not every demand can be met, however small.\n";
+  out << "At most " << last.flow << " is delivered, from " << last.factor * 100 << "% of the demand.\n";
+  std::cout << out.str();
+}
+
+void Runtime::handleDrought() {
+  std::vector<CurvePoint> curve = data->flowCurve(Scaling::Supply);
+  std::cout << "Water delivered with every reservoir at a percentage of its capacity (linear between the lines):\n";
+  printCurve(curve, "reservoirs at");
+  // the curve only grows, so the first point that delivers as much as the full reservoirs is where it goes flat
+  double full = curve.back().flow;
+  auto flat = std::find_if(curve.begin(), curve.end(),
+                           [full](const CurvePoint &point) { return point.flow >= full * (1 - 1e-9); });
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(2);
+  out << "The delivery (" << full << ") holds down to reservoirs at " << flat->factor * 100 << "%.\n";
+  std::cout << out.str();
+}
+
+void Runtime::handleMinCost() {
+  CostedFlow result = data->minCostFlow();
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(2);
+  out << "Cheapest delivery of the maximum flow:\n";
+  for (size_t i = 0; i < result.cities.size(); i++) {
+    const Info &info = data->getCities()[i]->getInfo();
+    if (info.isActive())
+      out << info.getCode() << " (" << StringPool::global().view(info.getLocationId()) << "): " << result.cities[i]
+          << '\n';
+  }
+  out << "Total: " << result.flow << " for a pumping cost of " << result.cost << " (the flow of the max-flow solver costs "
+      << result.solverCost << ").\n";
+  std::cout << out.str();
+  if (result.cost == 0 && result.solverCost == 0)
+    warning("No pipe has a pumping cost: fill the Cost column (the sixth) of Pipes.csv.");
 }
 
 void Runtime::processArgs(std::string args) {
@@ -307,13 +454,25 @@ void Runtime::processArgs(std::string args) {
   case Command::RmReservoir:
     return handleRmReservoir(cmd.args);
   case Command::NeedsMet:
-    return handleNeedsMet();
+    return handleNeedsMet(cmd.args);
   case Command::RmPump:
     return handleRmPump(cmd.args);
   case Command::RmPipe:
     return handleRmPipe(cmd.args);
   case Command::Balance:
       return handleBalanceGraph();
+  case Command::TopPipes:
+    return handleTopPipes(cmd.args);
+  case Command::Contingency:
+    return handleContingency(cmd.args);
+  case Command::Simulate:
+    return handleSimulate(cmd.args);
+  case Command::Growth:
+    return handleGrowth();
+  case Command::Drought:
+    return handleDrought();
+  case Command::MinCost:
+    return handleMinCost();
   default:
     error("AAAAAAAAAAAAAAAAAAAAAAA");
     break;
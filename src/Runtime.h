@@ -40,10 +40,7 @@ public:
     case Command:
       return std::get<std::string>(this->value);
     case Code:
-        {
-          auto code = this->getCode().value();
-          return Utils::parseId(code.first, code.second);
-        }
+      return this->getCode().value().toString();
     }
   }
   std::optional<uint32_t> getInt() {
@@ -59,14 +56,10 @@ public:
     case Sep:
       return {};
     case Code:
-        {
-          auto code = this->getCode().value();
-          return code.second;
-        }
-      break;
+      return this->getCode().value().getId();
     }
   }
-  std::optional<std::pair<Info::Kind, uint32_t>> getCode() {
+  std::optional<NodeCode> getCode() {
     switch (this->kind) {
     case Command:
       return {};
@@ -79,8 +72,7 @@ public:
     case Sep:
       return {};
     case Code:
-      return std::get<std::pair<Info::Kind, uint32_t>>(this->value);
-      break;
+      return std::get<NodeCode>(this->value);
     }
   }
 
@@ -124,7 +116,7 @@ public:
   }
 
 private:
-  std::variant<uint32_t, std::string, std::pair<Info::Kind, uint32_t>> value;
+  std::variant<uint32_t, std::string, NodeCode> value;
 };
 
 class Command {
@@ -139,6 +131,12 @@ public:
     RmPump,
     NeedsMet,
     Balance,
+    TopPipes,
+    Contingency,
+    Simulate,
+    Growth,
+    Drought,
+    MinCost,
   } command;
   std::vector<CommandLineValue> args;
   Command(Cmd typ, std::vector<CommandLineValue> args)
@@ -195,9 +193,17 @@ public:
   }
 
   static Parser<Command> parse_needsMet() {
-    return ws().pair(string_p("needsMet")).pair(ws()).pmap<Command>([](auto inp) {
+    auto sole = ws().pair(string_p("needsMet")).pair(ws()).pmap<Command>([](auto inp) {
       return Command(Command::NeedsMet, {});
     });
+    auto explain = ws().pair(string_p("needsMet"))
+                       .pair(ws())
+                       .pair(string_p("--explain"))
+                       .pair(ws())
+                       .pmap<Command>([](auto inp) {
+                         return Command(Command::NeedsMet, {CommandLineValue(CommandLineValue::Kind::Ident, std::string("explain"))});
+                       });
+    return alt(std::vector({explain, sole}));
   }
 
   static Parser<Command> parse_maxflowcity() {
@@ -274,6 +280,124 @@ public:
     return alt(std::vector({reservoir, reservoir_sole, pump, pump_sole, pipe, pipe_sole}));
   }
 
+  static Parser<Command> parse_topPipes() {
+    auto sole = ws().pair(string_p("topPipes"))
+                    .pair(ws())
+                    .pmap<Command>([](auto inp) {
+                      return Command(Command::TopPipes, {});
+                    });
+    auto with_args = ws().pair(string_p("topPipes"))
+                         .pair(ws())
+                         .pair(CommandLineValue::parse_int())
+                         .pmap<Command>([](auto inp) {
+                            auto [_, intt] = inp;
+                            return Command(Command::TopPipes, {intt});
+                         });
+    return alt(std::vector({with_args, sole}));
+  }
+
+  static Parser<Command> parse_contingency() {
+    auto sole = ws().pair(string_p("contingency"))
+                    .pair(ws())
+                    .pmap<Command>([](auto inp) {
+                      return Command(Command::Contingency, {});
+                    });
+    auto with_size = ws().pair(string_p("contingency"))
+                         .pair(ws())
+                         .pair(CommandLineValue::parse_int())
+                         .pmap<Command>([](auto inp) {
+                            auto [_, size] = inp;
+                            return Command(Command::Contingency, {size});
+                         });
+    auto with_args = ws().pair(string_p("contingency"))
+                         .pair(ws())
+                         .pair(CommandLineValue::parse_int())
+                         .pair(ws())
+                         .pair(CommandLineValue::parse_int())
+                         .pmap<Command>([](auto inp) {
+                            auto [r1, k] = inp;
+                            auto [r2, _] = r1;
+                            auto [__, size] = r2;
+                            return Command(Command::Contingency, {size, k});
+                         });
+    auto with_budget = ws().pair(string_p("contingency"))
+                           .pair(ws())
+                           .pair(CommandLineValue::parse_int())
+                           .pair(ws())
+                           .pair(CommandLineValue::parse_int())
+                           .pair(ws())
+                           .pair(CommandLineValue::parse_int())
+                           .pmap<Command>([](auto inp) {
+                              auto [r1, budget] = inp;
+                              auto [r2, _] = r1;
+                              auto [r3, k] = r2;
+                              auto [r4, __] = r3;
+                              auto [___, size] = r4;
+                              return Command(Command::Contingency, {size, k, budget});
+                           });
+    return alt(std::vector({with_budget, with_args, with_size, sole}));
+  }
+
+  static Parser<Command> parse_simulate() {
+    auto sole = ws().pair(string_p("simulate"))
+                    .pair(ws())
+                    .pmap<Command>([](auto inp) {
+                      return Command(Command::Simulate, {});
+                    });
+    auto with_failure = ws().pair(string_p("simulate"))
+                            .pair(ws())
+                            .pair(CommandLineValue::parse_int())
+                            .pmap<Command>([](auto inp) {
+                               auto [_, failure] = inp;
+                               return Command(Command::Simulate, {failure});
+                            });
+    auto with_samples = ws().pair(string_p("simulate"))
+                            .pair(ws())
+                            .pair(CommandLineValue::parse_int())
+                            .pair(ws())
+                            .pair(CommandLineValue::parse_int())
+                            .pmap<Command>([](auto inp) {
+                               auto [r1, samples] = inp;
+                               auto [r2, _] = r1;
+                               auto [__, failure] = r2;
+                               return Command(Command::Simulate, {failure, samples});
+                            });
+    auto with_seed = ws().pair(string_p("simulate"))
+                         .pair(ws())
+                         .pair(CommandLineValue::parse_int())
+                         .pair(ws())
+                         .pair(CommandLineValue::parse_int())
+                         .pair(ws())
+                         .pair(CommandLineValue::parse_int())
+                         .pmap<Command>([](auto inp) {
+                            auto [r1, seed] = inp;
+                            auto [r2, _] = r1;
+                            auto [r3, samples] = r2;
+                            auto [r4, __] = r3;
+                            auto [___, failure] = r4;
+                            return Command(Command::Simulate, {failure, samples, seed});
+                         });
+    return alt(std::vector({with_seed, with_samples, with_failure, sole}));
+  }
+
+  static Parser<Command> parse_growth() {
+    return ws().pair(string_p("growth")).pair(ws()).pmap<Command>([](auto inp) {
+      return Command(Command::Growth, {});
+    });
+  }
+
+  static Parser<Command> parse_drought() {
+    return ws().pair(string_p("drought")).pair(ws()).pmap<Command>([](auto inp) {
+      return Command(Command::Drought, {});
+    });
+  }
+
+  static Parser<Command> parse_minCost() {
+    return ws().pair(string_p("minCost")).pair(ws()).pmap<Command>([](auto inp) {
+      return Command(Command::MinCost, {});
+    });
+  }
+
     static Parser<Command> parse_balance() {
         return ws().pair(string_p("balanceGraph")).pair(ws()).pmap<Command>([](auto inp) {
             return Command(Command::Balance, {});
@@ -289,18 +413,30 @@ public:
       parse_maxflowcity(),
       parse_rm(),
       parse_balance(),
+      parse_topPipes(),
+      parse_contingency(),
+      parse_simulate(),
+      parse_growth(),
+      parse_drought(),
+      parse_minCost(),
     }));
   }
 
   void printHelp();
   void handleQuit();
   void handleCount();
-  void handleNeedsMet();
+  void handleNeedsMet(std::vector<CommandLineValue> args);
   void handleMaxFlowCity(std::vector<CommandLineValue> args);
   void handleRmReservoir(std::vector<CommandLineValue> args);
   void handleRmPump(std::vector<CommandLineValue> args);
   void handleRmPipe(std::vector<CommandLineValue> args);
   void handleBalanceGraph();
+  void handleTopPipes(std::vector<CommandLineValue> args);
+  void handleContingency(std::vector<CommandLineValue> args);
+  void handleSimulate(std::vector<CommandLineValue> args);
+  void handleGrowth();
+  void handleDrought();
+  void handleMinCost();
 };
 
 #endif // DA2324_PRJ1_G163_RUNTIME_H
@@ -0,0 +1,49 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned threads) {
+  for (unsigned i = 0; i < std::max(threads, 1u); i++)
+    this->threads.emplace_back(&ThreadPool::work, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (std::thread &thread : threads)
+    thread.join();
+}
+
+void ThreadPool::run(size_t count, const std::function<void(unsigned, size_t)> &task) {
+  if (count == 0)
+    return;
+  std::unique_lock<std::mutex> lock(mutex);
+  this->task = &task;
+  this->count = count;
+  next = 0;
+  busy = threads.size();
+  batch++;
+  lock.unlock();
+  wake.notify_all();
+  lock.lock();
+  done.wait(lock, [this] { return busy == 0; });
+}
+
+void ThreadPool::work(unsigned thread) {
+  uint64_t seen = 0;
+  while (true) {
+    std::unique_lock<std::mutex> lock(mutex);
+    wake.wait(lock, [this, seen] { return stopping || batch != seen; });
+    if (stopping)
+      return;
+    seen = batch;
+    lock.unlock();
+    for (size_t i = next++; i < count; i = next++)
+      (*task)(thread, i);
+    lock.lock();
+    if (--busy == 0)
+      done.notify_one();
+  }
+}
@@ -0,0 +1,58 @@
+#ifndef DA2324_PRJ1_G163_THREADPOOL_H
+#define DA2324_PRJ1_G163_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed set of threads that run batches of independent tasks.
+ * @details The threads live as long as the pool, so whatever they keep in `thread_local`
+ * storage (such as the query workspaces of Data) survives from one batch to the next.
+ * The tasks of a batch are handed out one at a time, so uneven tasks keep every thread busy.
+ */
+class ThreadPool {
+public:
+  /**
+   * @brief Starts the threads.
+   * @param threads: Number of threads (at least one)
+   */
+  explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency());
+  ~ThreadPool();
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /// Number of threads, which are numbered from 0
+  unsigned size() const { return threads.size(); }
+
+  /**
+   * @brief Runs `task(thread, i)` for every i in [0, count) and waits for all of them.
+   * @details A thread number is only used by one task at a time, so it can index per-thread state.
+   */
+  void run(size_t count, const std::function<void(unsigned, size_t)> &task);
+
+private:
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  /// Signals a new batch (or the end) to the threads, and the end of a batch to run()
+  std::condition_variable wake, done;
+  /// Current batch
+  const std::function<void(unsigned, size_t)> *task = nullptr;
+  size_t count = 0;
+  /// Next task of the batch to hand out
+  std::atomic<size_t> next{0};
+  /// Number of batches started, and threads still working on the current one
+  uint64_t batch = 0;
+  unsigned busy = 0;
+  bool stopping = false;
+
+  /// Body of a thread
+  void work(unsigned thread);
+};
+
+#endif // DA2324_PRJ1_G163_THREADPOOL_H
@@ -1,25 +1,177 @@
 #include "Data.h"
+#include "../../lib/UFDS.h"
+#include "../flow/Contraction.h"
+#include "../flow/MinCostFlow.h"
+#include "../flow/PipeMetrics.h"
+#include "../flow/Reroute.h"
+#include "../flow/Solvers.h"
+#include "../Philox.h"
+#include "../ThreadPool.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
+/// Converts a flow to whole units of water (flows of the `double` network are rounded).
+template <class F> static uint32_t toUnits(F flow) {
+  if constexpr (std::is_integral_v<F>)
+    return static_cast<uint32_t>(flow);
+  else
+    return static_cast<uint32_t>(std::round(flow));
+}
+
+/// Checks that an integer read from a csv file fits in [0, max], instead of silently truncating it.
+static uint32_t checkRange(int64_t value, int64_t max, const std::string &what) {
+  if (value < 0 || value > max)
+    panic(what + " out of range: " + std::to_string(value));
+  return static_cast<uint32_t>(value);
+}
+
+/// Checks that a line of a csv file has every required column, instead of reading past its values.
+static void checkColumns(const std::vector<CsvValues> &values, size_t required, const std::string &file) {
+  if (values.size() < required)
+    panic("Missing column in " + file + ": expected " + std::to_string(required) + " values, but found " +
+          std::to_string(values.size()));
+}
+
+/// Reads a decimal number (or an integer) from a csv file, which must be in [0, max].
+static float checkReal(CsvValues value, double max, const std::string &what) {
+  std::optional<double> number = value.get_flt();
+  if (!number.has_value() && value.get_int().has_value())
+    number = static_cast<double>(value.get_int().value());
+  if (!number.has_value())
+    panic("Incorrect type: Expected float, but found " + value.display());
+  if (*number < 0 || *number > max)
+    panic(what + " out of range: " + std::to_string(*number));
+  return static_cast<float>(*number);
+}
+
+/// Reads an optional column of a csv line (such as Failure or Cost), pairing its value with the builder index of the
+/// vertex or link of the line. An absent or empty column adds nothing.
+static void readOptional(const std::vector<CsvValues> &values, size_t column, size_t index, double max,
+                         const std::string &what, std::vector<std::pair<size_t, float>> &into) {
+  if (values.size() > column && values[column].variant != CsvValues::None)
+    into.emplace_back(index, checkReal(values[column], max, what));
+}
+
+/**
+ * @brief Scratch memory of the queries of one thread.
+ * @details Reused by every query, so a sweep (the same network solved once per
+ * scenario) does not allocate after its first scenario.
+ */
+struct QueryWorkspace {
+  /// Max-flow engines of each flow type, with their arrays. The incremental engine keeps the
+  /// search trees of the baseline of the sweeps.
+  std::tuple<SolverSet<int32_t>, SolverSet<int64_t>, SolverSet<double>> solvers;
+  /// Contraction of the network of each flow type, with the core solved by the engines
+  std::tuple<Contraction<int32_t>, Contraction<int64_t>, Contraction<double>> contractions;
+  /// Local rerouting of each flow type, tried before the incremental engine in the sweeps
+  std::tuple<Reroute<int32_t>, Reroute<int64_t>, Reroute<double>> reroutes;
+  /// Min-cost flow engine of each flow type
+  std::tuple<MinCostFlow<int32_t>, MinCostFlow<int64_t>, MinCostFlow<double>> minCostFlows;
+  /// Flow of each city of the unchanged network
+  std::vector<uint32_t> baseline;
+  /// Flow of each city in the scenario being evaluated
+  std::vector<uint32_t> scenario;
+};
+
+/// Vertexes the local rerouting of a scenario may visit before the scenario is left to the incremental engine
+static constexpr uint32_t REROUTE_BUDGET = 4096;
+
+/// Workspace of the calling thread
+static QueryWorkspace &workspace() {
+  thread_local QueryWorkspace ws;
+  return ws;
+}
+
 // Constructor
 
-Data::Data(Csv cities, Csv pipes, Csv reservoirs, Csv stations) {
-  this->g = Graph<Info>();
-  setCities(std::move(cities));
-  setReservoirs(std::move(reservoirs));
-  setStations(std::move(stations));
-  setPipes(std::move(pipes));
-    for (auto v : g.getVertexSet()) {
-        for (auto e: v->getAdj()) {
-            e->setFlow(0);
-        }
+/// Roots of the VertexOrder::BFS layout: the vertexes connected to the super source.
+static bool isReservoir(const Info &info) {
+  return info.getKind() == Info::Kind::Reservoir;
+}
+
+Data::Data(Csv cities, Csv pipes, Csv reservoirs, Csv stations, VertexOrder order) {
+  GraphBuilder<Info> builder(g);
+  std::vector<std::pair<size_t, float>> stationsFailing, pipesFailing, pipesCosting;
+  setCities(std::move(cities), builder);
+  setReservoirs(std::move(reservoirs), builder);
+  setStations(std::move(stations), builder, stationsFailing);
+  setPipes(std::move(pipes), builder, pipesFailing, pipesCosting);
+  builder.build(order, isReservoir);
+  for (auto [i, failure] : stationsFailing)
+    stationFailures[builder.getVertex(static_cast<int>(i))] = failure;
+  for (auto [i, failure] : pipesFailing)
+    pipeFailures[builder.getEdge(i)] = failure;
+  for (auto [i, cost] : pipesCosting)
+    pipeCosts[builder.getEdge(i)] = cost;
+  partitionVertexes();
+  compileNetwork();
+}
+
+Data::Data(const Snapshot &snapshot, VertexOrder order) {
+  const Snapshot::Header &header = snapshot.header();
+  const Snapshot::VertexRecord *records = snapshot.vertices();
+  GraphBuilder<Info> builder(g);
+  builder.reserve(header.vertexCount, header.edgeCount);
+  for (uint64_t i = 0; i < header.vertexCount; ++i) {
+    const Snapshot::VertexRecord &r = records[i];
+    auto kind = static_cast<Info::Kind>(r.kind);
+    std::variant<Info::ReservoirData, Info::PumpData, Info::CityData> data = Info::PumpData();
+    switch (kind) {
+    case Info::Kind::Reservoir:
+      data = Info::ReservoirData(static_cast<uint32_t>(r.cap), snapshot.string(r.location),
+                                 snapshot.string(r.municipality));
+      break;
+    case Info::Kind::City:
+      data = Info::CityData(r.cap, snapshot.string(r.location), r.population);
+      break;
+    case Info::Kind::Pump:
+      data = Info::PumpData(std::isinf(r.cap) ? std::nullopt : std::optional<uint32_t>(static_cast<uint32_t>(r.cap)));
+      break;
+    default:
+      panic("Invalid vertex kind in snapshot");
     }
+    if (!builder.addVertex(Info(kind, r.id, data)))
+      panic("Duplicate vertex in snapshot");
+  }
+
+  const Snapshot::EdgeRecord *edges = snapshot.edges();
+  for (uint64_t i = 0; i < header.edgeCount; ++i) {
+    const Snapshot::EdgeRecord &r = edges[i];
+    bool valid = r.undirected ? builder.addUndirectedEdge(r.orig, r.dest, r.capacity)
+                              : builder.addEdge(r.orig, r.dest, r.capacity);
+    if (!valid)
+      panic("Invalid pipe in snapshot");
+  }
+  builder.build(order, isReservoir);
+  for (uint64_t i = 0; i < header.vertexCount; ++i)
+    if (!std::isnan(records[i].failure))
+      stationFailures[builder.getVertex(i)] = records[i].failure;
+  for (uint64_t i = 0; i < header.edgeCount; ++i)
+    if (!std::isnan(edges[i].failure))
+      pipeFailures[builder.getEdge(i)] = edges[i].failure;
+  for (uint64_t i = 0; i < header.edgeCount; ++i)
+    if (edges[i].cost != 0)
+      pipeCosts[builder.getEdge(i)] = edges[i].cost;
+  partitionVertexes();
+  compileNetwork();
 }
 
-void Data::setCities(Csv cities) {
+void Data::setCities(Csv cities, GraphBuilder<Info> &builder) {
   std::vector<CsvLine> data = cities.to_data();
   for (CsvLine line : data) {
     std::vector<CsvValues> values = line.get_data();
@@ -27,27 +179,30 @@ void Data::setCities(Csv cities) {
       warning("Empty line in Cities.csv");
       continue;
     }
+    checkColumns(values, 5, "Cities.csv");
     if (!values[0].get_str().has_value())
       panic("Incorrect type: Expected string, but found " +
             values[0].display());
     std::string location = values[0].get_str().value();
     if (!values[1].get_int().has_value())
       panic("Incorrect type: Expected int, but found " + values[1].display());
-    uint32_t id = values[1].get_int().value();
+    uint32_t id = checkRange(values[1].get_int().value(), NodeCode::MAX_ID, "City id");
     if (!values[3].get_flt().has_value())
       panic("Incorrect type: Expected float, but found " + values[3].display());
-    float demand = values[3].get_flt().value();
+    double demand = values[3].get_flt().value();
+    if (demand < 0 || demand > UINT32_MAX)
+      panic("City demand out of range: " + std::to_string(demand));
     if (!values[4].get_int().has_value())
       panic("Incorrect type: Expected int, but found " + values[4].display());
-    uint32_t population = values[4].get_int().value();
+    uint32_t population = checkRange(values[4].get_int().value(), UINT32_MAX, "City population");
 
     const Info info = Info(Info::Kind::City, id,
                            Info::CityData(demand, location, population));
-    g.addVertex(info);
+    builder.addVertex(info);
   }
 }
 
-void Data::setReservoirs(Csv reservoirs) {
+void Data::setReservoirs(Csv reservoirs, GraphBuilder<Info> &builder) {
   std::vector<CsvLine> data = reservoirs.to_data();
   for (CsvLine line : data) {
     std::vector<CsvValues> values = line.get_data();
@@ -55,6 +210,7 @@ void Data::setReservoirs(Csv reservoirs) {
       warning("Empty line in Reservoir.csv");
       continue;
     }
+    checkColumns(values, 5, "Reservoir.csv");
 
     if (!values[0].get_str().has_value())
       panic("Incorrect type: Expected string, but found " +
@@ -66,19 +222,19 @@ void Data::setReservoirs(Csv reservoirs) {
     std::string municipality = values[1].get_str().value();
     if (!values[2].get_int().has_value())
       panic("Incorrect type: Expected int, but found " + values[2].display());
-    uint32_t id = values[2].get_int().value();
+    uint32_t id = checkRange(values[2].get_int().value(), NodeCode::MAX_ID, "Reservoir id");
     if (!values[4].get_int().has_value())
       panic("Incorrect type: Expected int, but found " + values[4].display());
-    uint32_t capacity = values[4].get_int().value();
+    uint32_t capacity = checkRange(values[4].get_int().value(), UINT32_MAX, "Reservoir capacity");
 
     const Info info =
         Info(Info::Kind::Reservoir, id,
              Info::ReservoirData(capacity, municipality, reservoir));
-    g.addVertex(info);
+    builder.addVertex(info);
   }
 }
 
-void Data::setStations(Csv stations) {
+void Data::setStations(Csv stations, GraphBuilder<Info> &builder, std::vector<std::pair<size_t, float>> &failures) {
   std::vector<CsvLine> data = stations.to_data();
   for (CsvLine line : data) {
     std::vector<CsvValues> values = line.get_data();
@@ -89,21 +245,34 @@ void Data::setStations(Csv stations) {
 
     if (!values[0].get_int().has_value())
       panic("Incorrect type: Expected int, but found" + values[0].display());
-    uint32_t id = values[0].get_int().value();
+    uint32_t id = checkRange(values[0].get_int().value(), NodeCode::MAX_ID, "Station id");
+
+    // optional throughput limit of the station
+    std::optional<uint32_t> capacity;
+    if (values.size() > 2 && values[2].variant != CsvValues::None) {
+      if (!values[2].get_int().has_value())
+        panic("Incorrect type: Expected int, but found" + values[2].display());
+      capacity = checkRange(values[2].get_int().value(), UINT32_MAX, "Station capacity");
+    }
 
-    const Info info = Info(Info::Kind::Pump, id, Info::PumpData());
-    g.addVertex(info);
+    const Info info = Info(Info::Kind::Pump, id, Info::PumpData(capacity));
+    // optional failure probability of the station (see simulate())
+    if (builder.addVertex(info))
+      readOptional(values, 3, builder.getNumVertex() - 1, 1, "Station failure probability", failures);
   }
 }
 
-void Data::setPipes(Csv pipes) {
+void Data::setPipes(Csv pipes, GraphBuilder<Info> &builder, std::vector<std::pair<size_t, float>> &failures,
+                    std::vector<std::pair<size_t, float>> &costs) {
   std::vector<CsvLine> data = pipes.to_data();
+  builder.reserve(builder.getNumVertex(), data.size());
   for (CsvLine line : data) {
     std::vector<CsvValues> values = line.get_data();
     if (values.empty()) {
       warning("Empty line in Pipes.csv");
       continue;
     }
+    checkColumns(values, 4, "Pipes.csv");
 
     if (!values[0].get_str().has_value())
       panic("Incorrect type: Expected string, but found" + values[0].display());
@@ -113,23 +282,27 @@ void Data::setPipes(Csv pipes) {
     std::string serviceB = values[1].get_str().value();
     if (!values[2].get_int().has_value())
       panic("Incorrect type: Expected int, but found" + values[2].display());
-    uint32_t capacity = values[2].get_int().value();
+    uint32_t capacity = checkRange(values[2].get_int().value(), UINT32_MAX, "Pipe capacity");
     if (!values[3].get_int().has_value())
       panic("Incorrect type: Expected int, but found" + values[3].display());
     bool unidirectional = values[3].get_int().value();
 
-    std::pair<Info::Kind, uint32_t> parsedA = Utils::parseCode(serviceA);
-    std::pair<Info::Kind, uint32_t> parsedB = Utils::parseCode(serviceB);
-    Vertex<Info> *vertexA = Utils::findVertex(g, parsedA.first, parsedA.second);
-    Vertex<Info> *vertexB = Utils::findVertex(g, parsedB.first, parsedB.second);
+    NodeCode codeA = Utils::parseCode(serviceA);
+    NodeCode codeB = Utils::parseCode(serviceB);
+    int vertexA = builder.findVertexIdx(Info(codeA.getKind(), codeA.getId(), Info::PumpData()));
+    int vertexB = builder.findVertexIdx(Info(codeB.getKind(), codeB.getId(), Info::PumpData()));
 
-    if (vertexA == nullptr || vertexB == nullptr)
+    if (vertexA == -1 || vertexB == -1)
       continue;
 
     if (!unidirectional)
-      g.addBidirectionalEdge(vertexA, vertexB, capacity);
+      builder.addUndirectedEdge(vertexA, vertexB, capacity);
     else
-      g.addEdge(vertexA, vertexB, capacity);
+      builder.addEdge(vertexA, vertexB, capacity);
+    // optional failure probability of the pipe (see simulate())
+    readOptional(values, 4, builder.getNumEdges() - 1, 1, "Pipe failure probability", failures);
+    // optional pumping cost per unit of water (see minCostFlow())
+    readOptional(values, 5, builder.getNumEdges() - 1, std::numeric_limits<float>::max(), "Pipe cost", costs);
   }
 }
 
@@ -138,214 +311,1723 @@ Graph<Info> &Data::getGraph() { return g; }
 // Functions
 // =================================================================================================
 
+void Data::partitionVertexes() {
+  for (auto &vertexes : kinds)
+    vertexes.clear();
+  for (Vertex<Info> *v : g.getVertexSet())
+    kinds[v->getInfo().getKind()].push_back(v);
+}
+
+const std::vector<Vertex<Info> *> &Data::getVertexes(Info::Kind kind) const {
+  return kinds.at(kind);
+}
+
+const std::vector<Vertex<Info> *> &Data::getReservoirs() const {
+  return kinds[Info::Kind::Reservoir];
+}
+
+const std::vector<Vertex<Info> *> &Data::getPumps() const {
+  return kinds[Info::Kind::Pump];
+}
+
+const std::vector<Vertex<Info> *> &Data::getCities() const {
+  return kinds[Info::Kind::City];
+}
+
 std::array<int, 3> Data::countVertexes() {
-  std::array<int, 3> counts = {0, 0, 0};
+  return {static_cast<int>(getCities().size()), static_cast<int>(getReservoirs().size()),
+          static_cast<int>(getPumps().size())};
+}
+
+void Data::compileNetwork() {
+  // integer flows are exact, but only if every capacity is an integer
+  bool integral = true;
+  double largest = 0, supply = 0;
+  auto check = [&integral, &largest](double capacity) {
+    integral = integral && std::floor(capacity) == capacity;
+    largest = std::max(largest, capacity);
+  };
+  for (Vertex<Info> *v : g.getVertexSet())
+    for (Edge<Info> *e : v->getAdj())
+      check(e->getWeight());
+  for (Vertex<Info> *v : getReservoirs()) {
+    check(v->getInfo().getCap().value());
+    supply += v->getInfo().getCap().value();
+  }
+  for (Vertex<Info> *v : getCities())
+    check(v->getInfo().getCap().value());
+  for (Vertex<Info> *v : getPumps())
+    if (v->getInfo().getCap().has_value())
+      check(v->getInfo().getCap().value());
+
+  // the backward residual of an undirected pipe can reach twice its capacity
+  constexpr double limit = std::numeric_limits<int32_t>::max() / 2;
+  if (!integral)
+    network.emplace<FlowNetwork<double>>();
+  else if (largest <= limit && supply <= limit)
+    network.emplace<FlowNetwork<int32_t>>();
+  else
+    network.emplace<FlowNetwork<int64_t>>();
+  try {
+    std::visit([this](auto &net) { compileNetwork(net); }, network);
+  } catch (const std::length_error &e) {
+    panic(std::string("The network is too large for the flow computations: ") + e.what());
+  }
+}
+
+template <class F> void Data::compileNetwork(FlowNetwork<F> &net) {
+  std::unordered_map<const Vertex<Info> *, uint32_t> ids;
+  ids.reserve(g.getNumVertex());
+  networkVertexes.clear();
   for (Vertex<Info> *v : g.getVertexSet()) {
-    switch (v->getInfo().getKind()) {
-    case Info::Kind::City:
-      ++counts[0];
-      break;
-    case Info::Kind::Reservoir:
-      ++counts[1];
-      break;
-    case Info::Kind::Pump:
-      ++counts[2];
-      break;
+    ids[v] = net.addVertex();
+    networkVertexes.push_back(v);
+  }
+  uint32_t s = net.addVertex();
+  uint32_t t = net.addVertex();
+  networkVertexes.push_back(nullptr);
+  networkVertexes.push_back(nullptr);
+  net.setTerminals(s, t);
+
+  // a pump with a throughput limit is split: its pipes arrive at ids[v] and leave from
+  // outIds[v], and a link with the capacity of the pump goes from the first to the second
+  std::unordered_map<const Vertex<Info> *, uint32_t> outIds;
+  for (Vertex<Info> *v : getPumps()) {
+    if (v->getInfo().getCap().has_value()) {
+      outIds[v] = net.addVertex();
+      networkVertexes.push_back(v);
+    }
+  }
+  siteVertexes.clear();
+  for (const auto &vertexes : {getReservoirs(), getPumps()})
+    for (Vertex<Info> *v : vertexes)
+      siteVertexes[v] = {ids[v], outIds.count(v) ? outIds[v] : FlowNetwork<F>::NONE};
+  auto out = [&ids, &outIds](const Vertex<Info> *v) {
+    auto it = outIds.find(v);
+    return it == outIds.end() ? ids[v] : it->second;
+  };
+
+  pipes.clear();
+  pipeIndex.clear();
+  reverseLinks.clear();
+  std::vector<std::pair<uint32_t, Edge<Info> *>> reversed;
+  for (Vertex<Info> *v : g.getVertexSet()) {
+    for (Edge<Info> *e : v->getAdj()) {
+      Vertex<Info> *w = e->getDest();
+      // an undirected pipe at a split pump cannot be a single link (its ends differ with the
+      // direction of the water), so it becomes two directed links, added after the others
+      bool split = e->isUndirected() && (outIds.count(v) || outIds.count(w));
+      uint32_t l = net.addLink(out(v), ids[w], static_cast<F>(e->getWeight()), e->isUndirected() && !split);
+      pipes.push_back(e);
+      pipeIndex.insert(v->getInfo().getCode(), w->getInfo().getCode(), l, e->isUndirected());
+      if (split)
+        reversed.emplace_back(l, e);
     }
   }
-  return counts;
+  for (Vertex<Info> *v : getReservoirs())
+    net.addLink(s, ids[v], static_cast<F>(v->getInfo().getCap().value()), false);
+  for (Vertex<Info> *v : getCities())
+    net.addLink(ids[v], t, static_cast<F>(v->getInfo().getCap().value()), false);
+  for (Vertex<Info> *v : getPumps())
+    if (outIds.count(v))
+      net.addLink(ids[v], outIds[v], static_cast<F>(v->getInfo().getCap().value()), false);
+  if (!reversed.empty())
+    reverseLinks.assign(pipes.size(), FlowNetwork<F>::NONE);
+  for (auto [l, e] : reversed)
+    reverseLinks[l] = net.addLink(out(e->getDest()), ids[e->getOrig()], static_cast<F>(e->getWeight()), false);
+  net.finalize();
 }
 
-std::unordered_map<uint16_t, uint32_t> Data::maxFlowCity() {
-  Vertex<Info> *superSource = Utils::createSuperSource(&g);
-  Vertex<Info> *superSink = Utils::createSuperSink(&g);
+uint32_t Data::cityLink(size_t i) const {
+  return pipes.size() + getReservoirs().size() + i;
+}
 
-  for (auto v: g.getVertexSet()) for (auto e: v->getAdj()) e->setFlow(0);
+void Data::setSolver(std::optional<Solver> engine) { solver = engine; }
 
-  Utils::EdmondsKarp(&g, superSource, superSink);
+template <class F> void Data::tuneSolver(FlowNetwork<F> &net) {
+  using Clock = std::chrono::steady_clock;
+  // every engine runs at least once, and again while it is fast enough for the timing to be noisy
+  constexpr int MAX_RUNS = 5;
+  constexpr auto MIN_TIME = std::chrono::milliseconds(20);
 
-  std::unordered_map<uint16_t, uint32_t> result;
-  for (Vertex<Info> *v : g.getVertexSet()) {
-    if (v->getInfo().getKind() != Info::Kind::City)
-      continue;
-    if (v->getInfo().isActive()) {
-      result.insert(
-          {v->getInfo().getId(), Utils::calcFlow(&this->getGraph(), v)});
+  std::ostringstream report;
+  report << "Solver timings:" << std::fixed << std::setprecision(3);
+  auto &solvers = std::get<SolverSet<F>>(workspace().solvers);
+  Clock::duration fastest = Clock::duration::max();
+  std::optional<F> value;
+  for (const SolverEntry &entry : SOLVERS) {
+    Clock::duration best = Clock::duration::max(), total = Clock::duration::zero();
+    for (int run = 0; run < MAX_RUNS && total < MIN_TIME; run++) {
+      net.clearFlow();
+      Clock::time_point start = Clock::now();
+      solvers.solve(entry.solver, net);
+      Clock::duration elapsed = Clock::now() - start;
+      best = std::min(best, elapsed);
+      total += elapsed;
+    }
+    if (value.has_value() && std::abs(static_cast<double>(net.value() - *value)) > 1e-6 * std::abs(static_cast<double>(*value)))
+      warning(std::string("Max-flow engine ") + entry.name + " disagrees with " + solverName(SOLVERS[0].solver));
+    value = net.value();
+    report << ' ' << entry.name << ' ' << std::chrono::duration<double, std::milli>(best).count() << " ms;";
+    if (best < fastest) {
+      fastest = best;
+      solver = entry.solver;
     }
   }
+  report << " using " << solverName(*solver) << " (pin it with --solver=" << solverName(*solver) << ")";
+  info(report.str());
+}
+
+void Data::solveNetwork() {
+  std::visit([this](auto &net) {
+    using F = typename std::decay_t<decltype(net)>::Flow;
+    QueryWorkspace &ws = workspace();
+    for (size_t i = 0; i < networkVertexes.size(); i++)
+      if (networkVertexes[i] != nullptr)
+        net.setActive(i, networkVertexes[i]->getInfo().isActive());
+    net.clearFlow();
+    auto &contraction = std::get<Contraction<F>>(ws.contractions);
+    FlowNetwork<F> &core = contraction.contract(net);
+    if (!solver.has_value()) {
+      tuneSolver(core);
+      core.clearFlow();
+    }
+    std::get<SolverSet<F>>(ws.solvers).solve(*solver, core);
+    contraction.expand(net);
+  }, network);
+}
+
+void Data::solveMaxFlow() {
+  solveNetwork();
+  std::visit([this](const auto &net) {
+    for (size_t l = 0; l < pipes.size(); l++)
+      pipes[l]->setFlow(pipeFlow(net, l));
+  }, network);
+}
+
+void Data::cityFlows(std::vector<uint32_t> &flows) const {
+  flows.resize(getCities().size());
+  std::visit([this, &flows](const auto &net) {
+    for (size_t i = 0; i < flows.size(); i++)
+      flows[i] = toUnits(net.getFlow(cityLink(i)));
+  }, network);
+}
+
+std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> Data::cityImpact(bool decreasedOnly) const {
+  const QueryWorkspace &ws = workspace();
+  std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> res;
+  for (size_t i = 0; i < ws.baseline.size(); i++) {
+    uint32_t flow = ws.baseline[i], newFlow = ws.scenario[i];
+    if (getCities()[i]->getInfo().isActive() && (decreasedOnly ? newFlow < flow : newFlow != flow))
+      res.emplace_back(getCities()[i]->getInfo().getId(), flow, newFlow);
+  }
+  return res;
+}
+
+bool Data::hasImpact(bool decreasedOnly) const {
+  const QueryWorkspace &ws = workspace();
+  for (size_t i = 0; i < ws.baseline.size(); i++) {
+    uint32_t flow = ws.baseline[i], newFlow = ws.scenario[i];
+    if (getCities()[i]->getInfo().isActive() && (decreasedOnly ? newFlow < flow : newFlow != flow))
+      return true;
+  }
+  return false;
+}
 
-  Utils::removeSuperSource(&g, superSource);
-  Utils::removeSuperSink(&g, superSink);
+uint64_t Data::lostFlow() const {
+  const QueryWorkspace &ws = workspace();
+  uint64_t lost = 0;
+  for (size_t i = 0; i < ws.baseline.size(); i++)
+    if (getCities()[i]->getInfo().isActive() && ws.scenario[i] < ws.baseline[i])
+      lost += ws.baseline[i] - ws.scenario[i];
+  return lost;
+}
+
+std::unordered_map<uint32_t, uint32_t> Data::maxFlowCity() {
+  solveMaxFlow();
+
+  std::unordered_map<uint32_t, uint32_t> result;
+  result.reserve(getCities().size());
+  std::visit([this, &result](const auto &net) {
+    for (size_t i = 0; i < getCities().size(); i++) {
+      const Info &info = getCities()[i]->getInfo();
+      if (info.isActive())
+        result.insert({info.getId(), toUnits(net.getFlow(cityLink(i)))});
+    }
+  }, network);
   return result;
 }
 
-std::vector<std::tuple<uint16_t, uint32_t, uint32_t>>
-Data::removeSite(Vertex<Info>* tgt) {
-  auto all_before = maxFlowCity();
-  Info inf = tgt->getInfo();
-  inf.disable();
-  tgt->setInfo(inf);
-  auto all_after = maxFlowCity();
-  inf.enable();
-  tgt->setInfo(inf);
-  std::vector<std::tuple<uint16_t, uint32_t, uint32_t>> res;
-  for (auto [bid, flow] : all_before) {
-    uint32_t new_flow = all_after.at(bid);
-    if (new_flow < flow) {
-      res.push_back(std::tuple(bid, flow, new_flow));
+template <class F> void Data::limitCities(FlowNetwork<F> &net, bool toBaseline) const {
+  for (size_t i = 0; i < getCities().size(); i++)
+    net.setCapacity(cityLink(i), toBaseline ? net.getFlow(cityLink(i))
+                                            : static_cast<F>(getCities()[i]->getInfo().getCap().value()));
+}
+
+template <class Change, class Result>
+void Data::sweep(size_t scenarios, Change change, Result result, bool solved) {
+  QueryWorkspace &ws = workspace();
+  if (!solved)
+    solveNetwork();
+  cityFlows(ws.baseline);
+
+  std::visit([&](auto &net) {
+    using F = typename std::decay_t<decltype(net)>::Flow;
+    auto &engine = std::get<SolverSet<F>>(ws.solvers).incremental();
+    auto &reroute = std::get<Reroute<F>>(ws.reroutes);
+    limitCities(net, true);
+    // search trees of the baseline max flow (no augmenting path is left)
+    engine.solve(net);
+    engine.save(net);
+    for (size_t i = 0; i < scenarios; i++) {
+      // most changes are absorbed by sending the water around them, without a global solve
+      reroute.begin(net);
+      change(net, reroute, i, true);
+      bool rerouted = reroute.route(net, REROUTE_BUDGET);
+      reroute.undo(net);
+      if (rerouted) {
+        ws.scenario = ws.baseline;
+      } else {
+        change(net, engine, i, true);
+        engine.resume(net);
+        cityFlows(ws.scenario);
+        change(net, engine, i, false);
+        engine.restore(net);
+      }
+      if (!result(i))
+        break;
     }
+    limitCities(net, false);
+  }, network);
+}
+
+template <class F, class Engine>
+void Data::changeSite(FlowNetwork<F> &net, Engine &engine, const Vertex<Info> *site, bool remove) {
+  auto it = siteVertexes.find(site);
+  if (it == siteVertexes.end())
+    return;
+  for (uint32_t v : {it->second.first, it->second.second}) {
+    if (v == FlowNetwork<F>::NONE)
+      continue;
+    if (remove)
+      engine.setActive(net, v, false);
+    else
+      net.setActive(v, true);
+  }
+}
+
+template <class F, class Engine>
+void Data::changePipe(FlowNetwork<F> &net, Engine &engine, uint32_t pipe, bool remove) {
+  for (uint32_t l : {pipe, reverseLinks.empty() ? FlowNetwork<F>::NONE : reverseLinks[pipe]}) {
+    if (l == FlowNetwork<F>::NONE)
+      continue;
+    if (remove)
+      engine.setCapacity(net, l, 0);
+    else
+      net.setCapacity(l, static_cast<F>(pipes[pipe]->getWeight()));
   }
+}
+
+std::vector<std::tuple<uint32_t, uint32_t, uint32_t>>
+Data::removeSite(Vertex<Info>* tgt) {
+  std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> res;
+  sweep(1, [this, tgt](auto &net, auto &engine, size_t, bool remove) {
+    changeSite(net, engine, tgt, remove);
+  }, [this, &res](size_t) {
+    res = cityImpact(true);
+    return true;
+  });
   return res;
 }
 
+std::vector<Vertex<Info> *> Data::removableSites(const std::vector<Vertex<Info> *> &sites) {
+  std::vector<Vertex<Info> *> removable;
+  sweep(sites.size(), [this, &sites](auto &net, auto &engine, size_t i, bool remove) {
+    changeSite(net, engine, sites[i], remove);
+  }, [this, &sites, &removable](size_t i) {
+    if (!hasImpact(true))
+      removable.push_back(sites[i]);
+    return true;
+  });
+  return removable;
+}
+
 std::vector<std::pair<Info, int32_t>> Data::meetsWaterNeeds() {
   std::vector<std::pair<Info, int32_t>> result;
-  Vertex<Info> *superSource = Utils::createSuperSource(&g);
-  Vertex<Info> *superSink = Utils::createSuperSink(&g);
+  solveMaxFlow();
 
-  Utils::EdmondsKarp(&g, superSource, superSink);
-  for (Vertex<Info> *v : g.getVertexSet()) {
-    if (v->getInfo().getKind() != Info::Kind::City)
+  std::visit([this, &result](const auto &net) {
+    for (size_t i = 0; i < getCities().size(); i++) {
+      const Info &info = getCities()[i]->getInfo();
+      int32_t deficit = std::round(info.getCap().value() - static_cast<double>(net.getFlow(cityLink(i))));
+      if (deficit > 0) {
+        result.emplace_back(info, deficit);
+      }
+    }
+  }, network);
+  return result;
+}
+
+std::vector<Bottleneck> Data::explainDeficits() {
+  std::vector<Bottleneck> groups;
+  std::visit([this, &groups](const auto &net) {
+    using F = typename std::decay_t<decltype(net)>::Flow;
+    constexpr uint32_t NONE = FlowNetwork<F>::NONE;
+    uint32_t s = net.getSource(), t = net.getSink();
+
+    // the cities in deficit (as in meetsWaterNeeds()) are the roots of one backward search
+    std::vector<uint32_t> deficit, label(net.getNumVertex(), NONE), queue;
+    for (size_t i = 0; i < getCities().size(); i++) {
+      const Info &info = getCities()[i]->getInfo();
+      if (std::round(info.getCap().value() - static_cast<double>(net.getFlow(cityLink(i)))) > 0) {
+        uint32_t v = net.getOrig(cityLink(i));
+        label[v] = deficit.size();
+        deficit.push_back(i);
+        queue.push_back(v);
+      }
+    }
+    // label: first city whose region reached the vertex; overlapping regions are joined
+    UFDS sets(deficit.size());
+    for (size_t head = 0; head < queue.size(); head++) {
+      uint32_t v = queue[head];
+      for (uint32_t a = net.arcBegin(v); a < net.arcEnd(v); a++) {
+        uint32_t x = net.arcHead(a);
+        if (x == s || x == t || !net.isActive(x) || net.residualFrom(net.arcLink(a), x) <= 0)
+          continue;
+        if (label[x] == NONE) {
+          label[x] = label[v];
+          queue.push_back(x);
+        } else {
+          sets.linkSets(label[x], label[v]);
+        }
+      }
+    }
+
+    auto code = [](const Vertex<Info> *v) { return v->getInfo().getCode(); };
+    std::vector<uint32_t> order(deficit.size());
+    for (uint32_t k = 0; k < order.size(); k++)
+      order[k] = k;
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+      return code(getCities()[deficit[a]]) < code(getCities()[deficit[b]]);
+    });
+    std::vector<uint32_t> groupOf(deficit.size(), NONE);
+    for (uint32_t k : order) {
+      uint32_t root = sets.findSet(k);
+      if (groupOf[root] == NONE) {
+        groupOf[root] = groups.size();
+        groups.emplace_back();
+      }
+      groups[groupOf[root]].cities.push_back(getCities()[deficit[k]]);
+    }
+
+    for (size_t i = 0; i < getCities().size(); i++) {
+      uint32_t v = net.getOrig(cityLink(i));
+      if (label[v] != NONE && deficit[label[v]] != i)
+        groups[groupOf[sets.findSet(label[v])]].sharedWith.push_back(getCities()[i]);
+    }
+
+    // the links that enter a region at full capacity
+    for (uint32_t w : queue) {
+      uint32_t group = groupOf[sets.findSet(label[w])];
+      for (uint32_t a = net.arcBegin(w); a < net.arcEnd(w); a++) {
+        uint32_t x = net.arcHead(a), l = net.arcLink(a);
+        F capacity = net.getOrig(l) == x ? net.getCapacity(l) : -net.getLower(l);
+        if (capacity <= 0 || net.residualFrom(l, x) > 0 ||
+            (label[x] != NONE && groupOf[sets.findSet(label[x])] == group))
+          continue;
+        Bottleneck &b = groups[group];
+        b.capacity += static_cast<double>(capacity);
+        if (x == s)
+          b.reservoirs.emplace_back(networkVertexes[w], static_cast<double>(capacity));
+        else if (networkVertexes[x] == networkVertexes[w]) // the link of a split pump
+          b.pumps.emplace_back(networkVertexes[w], static_cast<double>(capacity));
+        else
+          b.pipes.push_back({networkVertexes[x], networkVertexes[w], static_cast<double>(capacity)});
+      }
+    }
+    for (Bottleneck &b : groups) {
+      std::sort(b.pipes.begin(), b.pipes.end(), [&code](const auto &p, const auto &q) {
+        return code(p.from) < code(q.from) || (code(p.from) == code(q.from) && code(p.to) < code(q.to));
+      });
+      auto byCode = [&code](const auto &p, const auto &q) { return code(p.first) < code(q.first); };
+      std::sort(b.sharedWith.begin(), b.sharedWith.end(), [&code](const auto *v, const auto *w) { return code(v) < code(w); });
+      std::sort(b.reservoirs.begin(), b.reservoirs.end(), byCode);
+      std::sort(b.pumps.begin(), b.pumps.end(), byCode);
+    }
+  }, network);
+  return groups;
+}
+
+std::vector<uint32_t> Data::removablePipes() {
+  std::vector<uint32_t> removable;
+  sweep(pipes.size(), [this](auto &net, auto &engine, size_t l, bool remove) {
+    changePipe(net, engine, l, remove);
+  }, [this, &removable](size_t l) {
+    if (!hasImpact(false))
+      removable.push_back(l);
+    return true;
+  });
+  return removable;
+}
+
+std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> Data::removingPipe(uint32_t pipe) {
+  std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> res;
+  sweep(1, [this, pipe](auto &net, auto &engine, size_t, bool remove) {
+    changePipe(net, engine, pipe, remove);
+  }, [this, &res](size_t) {
+    res = cityImpact(false);
+    return true;
+  });
+  return res;
+}
+
+std::vector<std::pair<uint32_t, uint64_t>> Data::topPipes(size_t k, size_t &evaluated) {
+  evaluated = 0;
+  std::vector<std::pair<uint32_t, uint64_t>> top;
+  if (k == 0 || pipes.empty())
+    return top;
+
+  // a pipe cannot lose more water than it carries in the baseline
+  solveNetwork();
+  std::vector<double> bound(pipes.size());
+  std::visit([this, &bound](const auto &net) {
+    for (uint32_t l = 0; l < pipes.size(); l++)
+      bound[l] = std::abs(pipeFlow(net, l));
+  }, network);
+  std::vector<uint32_t> order(pipes.size());
+  for (uint32_t l = 0; l < order.size(); l++)
+    order[l] = l;
+  std::stable_sort(order.begin(), order.end(), [&bound](uint32_t a, uint32_t b) { return bound[a] > bound[b]; });
+  if (bound[order[0]] == 0)
+    return top;
+
+  // the k largest losses found, as a heap with the smallest (the latest evaluated among equals) on top
+  struct Found {
+    size_t rank;
+    uint64_t lost;
+  };
+  auto better = [](const Found &a, const Found &b) { return a.lost > b.lost || (a.lost == b.lost && a.rank < b.rank); };
+  std::vector<Found> heap;
+  sweep(order.size(), [this, &order](auto &net, auto &engine, size_t i, bool remove) {
+    changePipe(net, engine, order[i], remove);
+  }, [&](size_t i) {
+    evaluated++;
+    uint64_t lost = lostFlow();
+    if (lost > 0 && (heap.size() < k || better({i, lost}, heap.front()))) {
+      heap.push_back({i, lost});
+      std::push_heap(heap.begin(), heap.end(), better);
+      if (heap.size() > k) {
+        std::pop_heap(heap.begin(), heap.end(), better);
+        heap.pop_back();
+      }
+    }
+    // no pipe left can lose more than the k-th largest loss
+    if (i + 1 == order.size() || bound[order[i + 1]] == 0)
+      return false;
+    return heap.size() < k || static_cast<double>(heap.front().lost) < bound[order[i + 1]];
+  }, true);
+
+  std::sort(heap.begin(), heap.end(), better);
+  for (const Found &found : heap)
+    top.emplace_back(order[found.rank], found.lost);
+  return top;
+}
+
+/**
+ * @brief Best-first search of the combinations of failures that interact (see Data::contingencies()).
+ * @details The elements that can fail are the pipes, the reservoirs and the pumping stations. Removing a
+ * set S of them loses loss(S) water, and S interacts if loss(S) > loss(S - x) + loss(x) for every x in S.
+ * The scenario of S is a max flow without S, and it *touches* the links of S and the links whose flow
+ * differs from the baseline. The search does not solve the combinations that provably cannot interact or
+ * cannot beat the ones found:
+ * - *conflicts*: adding the changes of the scenario of x to the scenario of S - x conserves the water, but
+ *   may break the bounds of the links that both touch. If the water out of bounds is V, every cut without
+ *   S still lets through all but V of it, so loss(S) <= loss(S - x) + loss(x) + V. Scenarios that touch
+ *   no common link (in particular, failures in separate components of the network) do not interact, so
+ *   only the pairs whose scenarios overlap are considered, and an element is only added to a pair whose
+ *   scenario it overlaps. The same holds for the scenarios of three single failures;
+ * - *weights*: the baseline flow decomposes into paths, so S loses at most the water its elements carry in
+ *   the baseline. Likewise, S loses at most loss(x) plus the water the others carry in the scenario of x.
+ *
+ * Every element with water is first solved alone. The combinations of three are grown from the pairs
+ * whose scenarios overlap (so three failures without such a pair are not searched), and the other pairs
+ * they need are solved (and kept) on demand. The combinations are solved in batches by a ThreadPool, each
+ * thread on its own copy of the baseline network: the scenario is first rerouted locally, and otherwise
+ * solved incrementally from the baseline search trees. A combination that interacts is reported as soon
+ * as no combination left has a higher bound.
+ */
+template <class F>
+class ContingencySearch {
+public:
+  /**
+   * @brief Prepares the search on a network that holds the baseline flow, with the cities limited to it.
+   * @param size: Number of failures of the combinations (2 or 3)
+   */
+  ContingencySearch(Data &data, FlowNetwork<F> &network, unsigned size);
+
+  /**
+   * @brief Reports the combinations that interact from the worst, until k are reported or none is left.
+   * @details Each batch only takes the combinations whose scenarios fit in the budget. When the budget
+   * runs out, the combinations found but not reported yet are reported too, from the worst.
+   * @param budget: Most scenarios solved, the elements alone included (if they do not fit, none is solved)
+   * @param left: Set to the most water that a combination not reported can lose if the search stopped
+   * early, otherwise to 0
+   * @return The number of scenarios solved.
+   */
+  size_t run(size_t k, size_t budget, const std::function<void(const Contingency &)> &report, uint64_t &left);
+
+private:
+  static constexpr uint32_t NONE = FlowNetwork<F>::NONE;
+  /// Combinations taken from the search at a time, per thread
+  static constexpr size_t BATCH = 32;
+  /// Rounding of each loss of the double network (losses are whole units)
+  static constexpr double SLACK = std::is_integral_v<F> ? 0 : 0.5;
+
+  /// Failed elements in increasing order, followed by NONE
+  using Combo = std::array<uint32_t, 3>;
+  /// Flows of the links that differ from the baseline in a scenario, by link
+  using Flows = std::vector<std::pair<uint32_t, F>>;
+
+  /// Loss of a scenario and its flow (an index of ContingencySearch::flows)
+  struct Result {
+    uint64_t lost = 0;
+    uint32_t flow = 0;
+    /// Whether the combinations of three of this pair were generated
+    bool grown = false;
+  };
+
+  /// Combination waiting in the search
+  struct Item {
+    enum Kind : uint8_t {
+      /// Combination of three whose other pairs are not known yet
+      Candidate,
+      /// Its bound is refined: it is solved when taken
+      Ready,
+      /// Pair whose scenario gives the elements worth adding to it
+      Generator,
+    } kind;
+    /// Most water that it (or any combination it generates) can lose
+    uint64_t bound;
+    /// Largest loss of a part and the rest, which a combination that interacts exceeds
+    uint64_t parts;
+    /// Order of creation, which breaks the ties
+    uint64_t order;
+    Combo combo;
+  };
+
+  /// Combination that interacts, waiting to be reported
+  struct Found {
+    uint64_t lost;
+    uint64_t order;
+    Combo combo;
+  };
+
+  Data &data;
+  FlowNetwork<F> &network;
+  unsigned size;
+  /// Elements: the pipes (by id), then the sites
+  uint32_t pipeCount;
+  std::vector<Vertex<Info> *> sites;
+  /// Network vertexes of each site (the second is NONE if it has only one)
+  std::vector<std::pair<uint32_t, uint32_t>> siteVertex;
+  /// Water that each element carries in the baseline
+  std::vector<double> weight;
+  /// Component of the network of each element, and the largest loss of an element alone in each component
+  std::vector<uint32_t> component;
+  std::unordered_map<uint32_t, uint64_t> worst;
+  /// Baseline flow of each link and of each city
+  std::vector<F> baseFlow, baseCities;
+  /// Flow of each link in the scenario being grown (the baseline otherwise), so grow() reads it directly
+  std::vector<F> expanded;
+  uint32_t expandedScenario = NONE;
+
+  /// Flows of the scenarios kept (the first is the baseline)
+  std::vector<Flows> flows;
+  /// Result of each element alone (nothing lost for the elements without water)
+  std::vector<Result> singles;
+  /// Links touched by the scenario of each element alone, sorted
+  std::vector<std::vector<uint32_t>> touched;
+  /// Elements whose scenario alone touches each link
+  std::vector<std::vector<uint32_t>> users;
+  /// Elements whose scenarios alone overlap the scenario of each element, sorted, with the water that
+  /// the other scenario adds out of bounds to both (see spill())
+  std::vector<std::vector<std::pair<uint32_t, double>>> neighbours;
+  /// Number of the last overlapping() call that visited each element
+  std::vector<uint32_t> seen;
+  uint32_t stamp = 0;
+  /// Results of the pairs solved or derived so far
+  std::unordered_map<uint64_t, Result> pairs;
+
+  /// Combinations waiting, as a heap from the highest bound
+  std::vector<Item> pending;
+  /// Combinations that interact waiting to be reported, as a heap from the largest loss
+  std::vector<Found> found;
+  /// The k largest losses found, from the smallest: a combination that cannot reach it is not needed
+  std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<>> best;
+  size_t limit = 0;
+  uint64_t order = 0;
+  size_t solved = 0;
+
+  ThreadPool pool;
+  /// Copy of the network of each thread, and whether its search trees are ready
+  std::vector<FlowNetwork<F>> copies;
+  std::vector<uint8_t> prepared;
+
+  /// Whole units of water below which a flow stays (after rounding)
+  static uint64_t ceilUnits(double flow) { return static_cast<uint64_t>(std::ceil(flow)); }
+
+  static bool lowerBound(const Item &a, const Item &b) {
+    return a.bound < b.bound || (a.bound == b.bound && a.order > b.order);
+  }
+
+  static bool smallerLoss(const Found &a, const Found &b) {
+    return a.lost < b.lost || (a.lost == b.lost && a.order > b.order);
+  }
+
+  uint64_t pairKey(uint32_t a, uint32_t b) const { return uint64_t(a) * weight.size() + b; }
+
+  /// Smallest loss that a combination needs to be among the k worst
+  uint64_t threshold() const { return best.size() < limit ? 0 : best.top(); }
+
+  /// The combination without its i-th element
+  static Combo without(const Combo &combo, unsigned n, unsigned i) {
+    Combo part{NONE, NONE, NONE};
+    for (unsigned j = 0, k = 0; j < n; j++)
+      if (j != i)
+        part[k++] = combo[j];
+    return part;
+  }
+
+  /// Flow of a link in a scenario
+  F flowOf(uint32_t scenario, uint32_t l) const {
+    if (scenario == expandedScenario)
+      return expanded[l];
+    const Flows &changed = flows[scenario];
+    auto it = std::lower_bound(changed.begin(), changed.end(), l,
+                               [](const std::pair<uint32_t, F> &entry, uint32_t link) { return entry.first < link; });
+    return it != changed.end() && it->first == l ? it->second : baseFlow[l];
+  }
+
+  /// Change of the flow of a link in a scenario
+  double delta(uint32_t scenario, uint32_t l) const {
+    return static_cast<double>(flowOf(scenario, l)) - static_cast<double>(baseFlow[l]);
+  }
+
+  /// Water that an element carries in a scenario
+  double carried(uint32_t scenario, uint32_t e) const {
+    if (e < pipeCount) {
+      double water = std::abs(static_cast<double>(flowOf(scenario, e)));
+      if (!data.reverseLinks.empty() && data.reverseLinks[e] != NONE)
+        water += std::abs(static_cast<double>(flowOf(scenario, data.reverseLinks[e])));
+      return water;
+    }
+    uint32_t v = siteVertex[e - pipeCount].first;
+    double water = 0;
+    for (uint32_t a = network.arcBegin(v); a < network.arcEnd(v); a++) {
+      uint32_t l = network.arcLink(a);
+      double in = static_cast<double>(flowOf(scenario, l));
+      water += std::max(0.0, network.getDest(l) == v ? in : -in);
+    }
+    return water;
+  }
+
+  /// Calls visit(l) for every link of an element (a site has the links of its vertexes)
+  template <class Visit> void ownLinks(uint32_t e, Visit visit) const {
+    if (e < pipeCount) {
+      visit(e);
+      if (!data.reverseLinks.empty() && data.reverseLinks[e] != NONE)
+        visit(data.reverseLinks[e]);
+      return;
+    }
+    auto [v, w] = siteVertex[e - pipeCount];
+    for (uint32_t u : {v, w})
+      if (u != NONE)
+        for (uint32_t a = network.arcBegin(u); a < network.arcEnd(u); a++)
+          visit(network.arcLink(a));
+  }
+
+  /// Whether a link is a link of an element
+  bool owns(uint32_t e, uint32_t l) const {
+    if (e < pipeCount)
+      return l == e || (!data.reverseLinks.empty() && data.reverseLinks[e] == l);
+    auto [v, w] = siteVertex[e - pipeCount];
+    for (uint32_t u : {network.getOrig(l), network.getDest(l)})
+      if (u == v || (w != NONE && u == w))
+        return true;
+    return false;
+  }
+
+  /// Whether a link is touched by the scenario of a combination of n elements
+  bool touches(const Combo &combo, unsigned n, const Result &result, uint32_t l) const {
+    for (unsigned i = 0; i < n; i++)
+      if (owns(combo[i], l))
+        return true;
+    return flowOf(result.flow, l) != baseFlow[l];
+  }
+
+  /// Links touched by the scenario of a combination of n elements, sorted
+  std::vector<uint32_t> touches(const Combo &combo, unsigned n, const Result &result) const {
+    std::vector<uint32_t> links;
+    for (const auto &[l, flow] : flows[result.flow])
+      links.push_back(l);
+    for (unsigned i = 0; i < n; i++)
+      ownLinks(combo[i], [&links](uint32_t l) { links.push_back(l); });
+    std::sort(links.begin(), links.end());
+    links.erase(std::unique(links.begin(), links.end()), links.end());
+    return links;
+  }
+
+  /// Calls visit(e) once for every element whose scenario alone touches one of some links
+  template <class Visit> void overlapping(const std::vector<uint32_t> &links, Visit visit) {
+    if (++stamp == 0) {
+      std::fill(seen.begin(), seen.end(), 0);
+      stamp = 1;
+    }
+    for (uint32_t l : links) {
+      for (uint32_t e : users[l]) {
+        if (seen[e] != stamp) {
+          seen[e] = stamp;
+          visit(e);
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Water out of bounds when the changes of the scenario of x are added to the scenario of a
+   * combination of n elements, with x removed too (0 if the scenarios touch no common link).
+   */
+  double conflict(const Combo &combo, unsigned n, const Result &result, uint32_t x) const;
+
+  /**
+   * @brief Most water that the scenario of c adds out of bounds to the scenarios of x and of any other
+   * element at once, beyond the conflict of those two (see the conflicts of ContingencySearch).
+   */
+  double spill(uint32_t x, uint32_t c) const;
+
+  /// Keeps the flow of a scenario, returning its index
+  uint32_t keep(Flows &&changed) {
+    if (changed.empty())
+      return 0;
+    flows.push_back(std::move(changed));
+    return flows.size() - 1;
+  }
+
+  /// Removes the elements of a combination through an engine (Reroute or BoykovKolmogorov), or restores them
+  template <class Engine> void change(FlowNetwork<F> &net, Engine &engine, const Combo &combo, bool remove) {
+    for (uint32_t e : combo) {
+      if (e == NONE)
+        break;
+      if (e < pipeCount)
+        data.changePipe(net, engine, e, remove);
+      else
+        data.changeSite(net, engine, sites[e - pipeCount], remove);
+    }
+  }
+
+  /// Solves the scenario of a combination on the copy of a thread, optionally keeping its flow
+  Result solve(unsigned thread, const Combo &combo, Flows *changed);
+
+  /// Solves the scenarios of some combinations in parallel
+  std::vector<Result> solveAll(const std::vector<Combo> &combos, bool keepFlows);
+
+  /// Stores the result of a pair that can be derived from its elements without solving it
+  bool derive(const Combo &pair);
+
+  /// Most water that a combination of n elements can lose, from its weights and the scenarios of its elements
+  uint64_t singlesBound(const Combo &combo, unsigned n) const;
+
+  /// Most water that a combination of three generated by a pair can lose
+  uint64_t generatorBound(uint32_t a, uint32_t b) const;
+
+  /// Adds an item to the search, unless it cannot be among the k worst
+  void push(const Item &item);
+
+  /// Adds a pair to the search, unless it cannot interact
+  void offerPair(uint32_t a, uint32_t b);
+
+  /// Refines a combination of three from the results of its pairs, returning whether it may still interact
+  bool refine(Item &item) const;
+
+  /// Adds the combinations of three that a solved pair generates to the search
+  void grow(const Combo &pair);
+
+  /**
+   * @brief Number of scenarios that taking an item solves, given the pairs already scheduled in the batch.
+   * @details A combination that is ready is solved; the other items need the pairs that are neither known
+   * nor derivable, which are added to scheduled.
+   */
+  size_t scenarios(const Item &item, std::unordered_set<uint64_t> &scheduled);
+
+  /// Processes a batch of combinations taken from the search
+  void process(std::vector<Item> &items);
+};
+
+template <class F>
+ContingencySearch<F>::ContingencySearch(Data &data, FlowNetwork<F> &network, unsigned size)
+    : data(data), network(network), size(size), pipeCount(data.pipes.size()) {
+  for (Info::Kind kind : {Info::Kind::Reservoir, Info::Kind::Pump}) {
+    for (Vertex<Info> *site : data.getVertexes(kind)) {
+      auto it = data.siteVertexes.find(site);
+      if (site->getInfo().isActive() && it != data.siteVertexes.end()) {
+        sites.push_back(site);
+        siteVertex.push_back(it->second);
+      }
+    }
+  }
+  uint32_t n = pipeCount + sites.size();
+
+  baseFlow.assign(network.flowData(), network.flowData() + network.getNumLinks());
+  expanded = baseFlow;
+  for (size_t i = 0; i < data.getCities().size(); i++)
+    baseCities.push_back(network.getFlow(data.cityLink(i)));
+  flows.emplace_back();
+  weight.resize(n);
+  for (uint32_t e = 0; e < n; e++)
+    weight[e] = carried(0, e);
+
+  // the terminals are left out: every reservoir and city has its own link to them
+  UFDS sets(network.getNumVertex());
+  for (uint32_t l = 0; l < network.getNumLinks(); l++) {
+    uint32_t u = network.getOrig(l), v = network.getDest(l);
+    bool terminal = u == network.getSource() || v == network.getSink() || u == network.getSink() ||
+                    v == network.getSource();
+    if (!terminal && network.isActive(u) && network.isActive(v))
+      sets.linkSets(u, v);
+  }
+  component.resize(n);
+  for (uint32_t e = 0; e < n; e++)
+    component[e] = sets.findSet(e < pipeCount ? network.getOrig(e) : siteVertex[e - pipeCount].first);
+
+  singles.resize(n);
+  touched.resize(n);
+  users.resize(network.getNumLinks());
+  seen.assign(n, 0);
+  copies.resize(pool.size());
+  prepared.assign(pool.size(), 0);
+}
+
+template <class F>
+double ContingencySearch<F>::conflict(const Combo &combo, unsigned n, const Result &result, uint32_t x) const {
+  double excess = 0;
+  for (uint32_t l : touched[x]) {
+    bool theirs = false;
+    for (unsigned i = 0; i < n; i++)
+      theirs = theirs || owns(combo[i], l);
+    if (!theirs && flowOf(result.flow, l) == baseFlow[l])
       continue;
-    double flow = 0;
-    for (Edge<Info> *e : v->getIncoming())
-      flow += e->getFlow();
-    int32_t deficit = round(v->getInfo().getCap().value() - flow);
-    if (deficit > 0) {
-      result.emplace_back(v->getInfo(), deficit);
+    // the links of removed elements must be empty
+    bool removed = theirs || owns(x, l);
+    double flow = static_cast<double>(flowOf(result.flow, l)) + delta(singles[x].flow, l);
+    double lower = removed ? 0 : static_cast<double>(network.getLower(l));
+    double upper = removed ? 0 : static_cast<double>(network.getCapacity(l));
+    excess += std::max({0.0, lower - flow, flow - upper});
+  }
+  return excess;
+}
+
+template <class F> double ContingencySearch<F>::spill(uint32_t x, uint32_t c) const {
+  // on a link of c, the other changes are left out of bounds; elsewhere, at most the change of c
+  double water = 0;
+  for (uint32_t l : touched[c]) {
+    if (!std::binary_search(touched[x].begin(), touched[x].end(), l))
+      continue;
+    water += std::abs(owns(c, l) ? delta(singles[x].flow, l) : delta(singles[c].flow, l));
+  }
+  return water;
+}
+
+template <class F>
+typename ContingencySearch<F>::Result ContingencySearch<F>::solve(unsigned thread, const Combo &combo, Flows *changed) {
+  QueryWorkspace &ws = workspace();
+  auto &engine = std::get<SolverSet<F>>(ws.solvers).incremental();
+  auto &reroute = std::get<Reroute<F>>(ws.reroutes);
+  FlowNetwork<F> &net = copies[thread];
+  if (!prepared[thread]) {
+    // search trees of the baseline max flow, in the workspace of this thread
+    net = network;
+    engine.solve(net);
+    engine.save(net);
+    prepared[thread] = 1;
+  }
+
+  Result result;
+  reroute.begin(net);
+  change(net, reroute, combo, true);
+  if (reroute.route(net, REROUTE_BUDGET)) {
+    if (changed != nullptr) {
+      reroute.changedLinks([changed](uint32_t l) { changed->emplace_back(l, 0); });
+      std::sort(changed->begin(), changed->end());
+      changed->erase(std::unique(changed->begin(), changed->end()), changed->end());
+      for (auto &[l, flow] : *changed)
+        flow = net.getFlow(l);
+      changed->erase(std::remove_if(changed->begin(), changed->end(),
+                                    [this](const std::pair<uint32_t, F> &entry) {
+                                      return entry.second == baseFlow[entry.first];
+                                    }),
+                     changed->end());
     }
+    reroute.undo(net);
+    return result;
   }
+  reroute.undo(net);
 
-  Utils::removeSuperSource(&g, superSource);
-  Utils::removeSuperSink(&g, superSink);
+  change(net, engine, combo, true);
+  engine.resume(net);
+  double lost = 0;
+  for (size_t i = 0; i < baseCities.size(); i++)
+    if (data.getCities()[i]->getInfo().isActive())
+      lost += static_cast<double>(baseCities[i]) - static_cast<double>(net.getFlow(data.cityLink(i)));
+  result.lost = static_cast<uint64_t>(std::llround(std::max(0.0, lost)));
+  if (changed != nullptr)
+    for (uint32_t l = 0; l < net.getNumLinks(); l++)
+      if (net.getFlow(l) != baseFlow[l])
+        changed->emplace_back(l, net.getFlow(l));
+  change(net, engine, combo, false);
+  engine.restore(net);
   return result;
 }
 
-// For each examined pipeline, list the affected cities displaying their codes
-// and water supply in deficit.
-std::unordered_map<std::pair<std::string, std::string>,
-                   std::unordered_map<uint16_t, uint32_t>, pair_hash>
-Data::removingPipes() {
-  std::unordered_map<uint16_t, uint32_t> maxFlows = maxFlowCity();
+template <class F>
+std::vector<typename ContingencySearch<F>::Result>
+ContingencySearch<F>::solveAll(const std::vector<Combo> &combos, bool keepFlows) {
+  std::vector<Result> results(combos.size());
+  std::vector<Flows> changed(keepFlows ? combos.size() : 0);
+  pool.run(combos.size(), [&](unsigned thread, size_t i) {
+    results[i] = solve(thread, combos[i], keepFlows ? &changed[i] : nullptr);
+  });
+  solved += combos.size();
+  if (keepFlows)
+    for (size_t i = 0; i < combos.size(); i++)
+      results[i].flow = keep(std::move(changed[i]));
+  return results;
+}
 
-  for (Vertex<Info> *v : g.getVertexSet()) {
-    for (Edge<Info> *e : v->getAdj()) {
-      e->setSelected(false); // not analyzed yet
+template <class F> bool ContingencySearch<F>::derive(const Combo &pair) {
+  const Result &a = singles[pair[0]], &b = singles[pair[1]];
+  Result derived;
+  if (component[pair[0]] != component[pair[1]]) {
+    // both scenarios at once
+    Flows merged;
+    std::merge(flows[a.flow].begin(), flows[a.flow].end(), flows[b.flow].begin(), flows[b.flow].end(),
+               std::back_inserter(merged));
+    derived = {a.lost + b.lost, keep(std::move(merged))};
+  } else if (carried(a.flow, pair[1]) == 0) {
+    // the flow without the first element does not need the second
+    derived = {a.lost, a.flow};
+  } else if (carried(b.flow, pair[0]) == 0) {
+    derived = {b.lost, b.flow};
+  } else {
+    return false;
+  }
+  pairs.emplace(pairKey(pair[0], pair[1]), derived);
+  return true;
+}
+
+template <class F> uint64_t ContingencySearch<F>::singlesBound(const Combo &combo, unsigned n) const {
+  double total = 0;
+  for (unsigned i = 0; i < n; i++)
+    total += weight[combo[i]];
+  uint64_t bound = ceilUnits(total);
+  // without x, the others lose at most the water they carry in the scenario of x
+  for (unsigned i = 0; i < n; i++) {
+    const Result &alone = singles[combo[i]];
+    double water = 0;
+    for (unsigned j = 0; j < n; j++)
+      if (j != i)
+        water += carried(alone.flow, combo[j]);
+    bound = std::min(bound, alone.lost + ceilUnits(water + SLACK));
+  }
+  return bound;
+}
+
+template <class F> uint64_t ContingencySearch<F>::generatorBound(uint32_t a, uint32_t b) const {
+  // the changes of the three scenarios alone, added up: a third element whose scenario overlaps neither
+  // of the others adds no conflict
+  uint64_t lost = singles[a].lost + singles[b].lost;
+  double conflicts = conflict({a, NONE, NONE}, 1, singles[a], b) + 3 * SLACK;
+  uint64_t bound = lost + worst.at(component[a]) + ceilUnits(conflicts);
+  const auto &na = neighbours[a], &nb = neighbours[b];
+  auto ia = na.begin(), ib = nb.begin();
+  while (ia != na.end() || ib != nb.end()) {
+    uint32_t c = std::min(ia == na.end() ? NONE : ia->first, ib == nb.end() ? NONE : ib->first);
+    double water = conflicts;
+    if (ia != na.end() && ia->first == c)
+      water += (ia++)->second;
+    if (ib != nb.end() && ib->first == c)
+      water += (ib++)->second;
+    if (c != a && c != b)
+      bound = std::max(bound, std::min(ceilUnits(weight[a] + weight[b] + weight[c]),
+                                       lost + singles[c].lost + ceilUnits(water)));
+  }
+  return bound;
+}
+
+template <class F> void ContingencySearch<F>::push(const Item &item) {
+  if (item.bound == 0 || item.bound < threshold())
+    return;
+  pending.push_back(item);
+  std::push_heap(pending.begin(), pending.end(), lowerBound);
+}
+
+template <class F> void ContingencySearch<F>::offerPair(uint32_t a, uint32_t b) {
+  double water = conflict({a, NONE, NONE}, 1, singles[a], b);
+  if (water == 0)
+    return;
+  uint64_t parts = singles[a].lost + singles[b].lost;
+  uint64_t bound = std::min(singlesBound({a, b, NONE}, 2), parts + ceilUnits(water + 2 * SLACK));
+  if (bound > parts)
+    push({Item::Ready, bound, parts, order++, {a, b, NONE}});
+}
+
+template <class F> bool ContingencySearch<F>::refine(Item &item) const {
+  for (unsigned i = 0; i < 3; i++) {
+    Combo pair = without(item.combo, 3, i);
+    uint32_t x = item.combo[i];
+    const Result &part = pairs.at(pairKey(pair[0], pair[1]));
+    double water = conflict(pair, 2, part, x);
+    if (water == 0)
+      return false;
+    uint64_t parts = part.lost + singles[x].lost;
+    item.bound = std::min({item.bound, part.lost + ceilUnits(carried(part.flow, x) + SLACK),
+                           parts + ceilUnits(water + 2 * SLACK)});
+    item.parts = std::max(item.parts, parts);
+  }
+  item.kind = Item::Ready;
+  return item.bound > item.parts;
+}
+
+template <class F> void ContingencySearch<F>::grow(const Combo &pair) {
+  uint32_t a = pair[0], b = pair[1];
+  Result &part = pairs.at(pairKey(a, b));
+  part.grown = true;
+  for (const auto &[l, flow] : flows[part.flow])
+    expanded[l] = flow;
+  expandedScenario = part.flow;
+  overlapping(touches(pair, 2, part), [&](uint32_t c) {
+    if (c == a || c == b)
+      return;
+    uint64_t parts = part.lost + singles[c].lost;
+    uint64_t bound = part.lost + ceilUnits(carried(part.flow, c) + SLACK);
+    if (bound <= parts || bound < threshold())
+      return;
+    double water = conflict(pair, 2, part, c);
+    if (water == 0)
+      return;
+    // another pair of the combination may have generated it already
+    for (uint32_t x : {a, b}) {
+      Combo other{std::min(x, c), std::max(x, c), NONE};
+      auto it = pairs.find(pairKey(other[0], other[1]));
+      if (it == pairs.end() || !it->second.grown)
+        continue;
+      const std::vector<uint32_t> &links = touched[x == a ? b : a];
+      if (std::any_of(links.begin(), links.end(), [&](uint32_t l) { return touches(other, 2, it->second, l); }))
+        return;
     }
+    Combo triple{a, b, c};
+    std::sort(triple.begin(), triple.end());
+    bound = std::min({bound, parts + ceilUnits(water + 2 * SLACK), singlesBound(triple, 3)});
+    if (bound > parts)
+      push({Item::Candidate, bound, parts, order++, triple});
+  });
+  expandedScenario = NONE;
+  for (const auto &[l, flow] : flows[part.flow])
+    expanded[l] = baseFlow[l];
+}
+
+template <class F>
+size_t ContingencySearch<F>::scenarios(const Item &item, std::unordered_set<uint64_t> &scheduled) {
+  if (item.kind == Item::Ready)
+    return 1;
+  size_t count = 0;
+  auto need = [&](const Combo &pair) {
+    uint64_t key = pairKey(pair[0], pair[1]);
+    if (!pairs.contains(key) && !derive(pair) && scheduled.insert(key).second)
+      count++;
+  };
+  if (item.kind == Item::Generator)
+    need(item.combo);
+  else
+    for (unsigned i = 0; i < 3; i++)
+      need(without(item.combo, 3, i));
+  return count;
+}
+
+template <class F> void ContingencySearch<F>::process(std::vector<Item> &items) {
+  // the pairs that the batch needs, solved together
+  std::vector<Combo> unsolved;
+  auto need = [this, &unsolved](const Combo &pair) {
+    if (!pairs.contains(pairKey(pair[0], pair[1])) && !derive(pair))
+      unsolved.push_back(pair);
+  };
+  for (const Item &item : items) {
+    if (item.kind == Item::Generator)
+      need(item.combo);
+    else if (item.kind == Item::Candidate)
+      for (unsigned i = 0; i < 3; i++)
+        need(without(item.combo, 3, i));
   }
+  std::sort(unsolved.begin(), unsolved.end());
+  unsolved.erase(std::unique(unsolved.begin(), unsolved.end()), unsolved.end());
+  std::vector<Result> results = solveAll(unsolved, true);
+  for (size_t i = 0; i < unsolved.size(); i++)
+    pairs.emplace(pairKey(unsolved[i][0], unsolved[i][1]), results[i]);
 
-  using EdgeKey = std::pair<std::string, std::string>;
-  std::unordered_map<EdgeKey, std::unordered_map<uint16_t, uint32_t>, pair_hash>
-      pipeImpactMap;
+  std::vector<Item> ready;
+  std::vector<Combo> combos;
+  for (Item &item : items) {
+    if (item.kind == Item::Ready) {
+      ready.push_back(item);
+      combos.push_back(item.combo);
+    } else if (item.kind == Item::Generator) {
+      grow(item.combo);
+    } else if (refine(item)) {
+      push(item);
+    }
+  }
+  results = solveAll(combos, false);
+  for (size_t i = 0; i < ready.size(); i++) {
+    if (results[i].lost > ready[i].parts) {
+      found.push_back({results[i].lost, ready[i].order, ready[i].combo});
+      std::push_heap(found.begin(), found.end(), smallerLoss);
+      best.push(results[i].lost);
+      if (best.size() > limit)
+        best.pop();
+    }
+  }
+}
 
-  for (Vertex<Info> *v : g.getVertexSet()) {
-    for (Edge<Info> *e : v->getAdj()) {
-      if (e->isSelected()) {
+template <class F>
+size_t ContingencySearch<F>::run(size_t k, size_t budget, const std::function<void(const Contingency &)> &report,
+                          uint64_t &left) {
+  limit = k;
+  left = 0;
+  std::vector<Combo> alone;
+  for (uint32_t e = 0; e < weight.size(); e++)
+    if (weight[e] > 0)
+      alone.push_back({e, NONE, NONE});
+  if (alone.size() > budget) {
+    // the search needs every element alone: without them, only the weights bound the losses
+    std::vector<double> heaviest(weight);
+    std::sort(heaviest.begin(), heaviest.end(), std::greater<>());
+    double water = 0;
+    for (unsigned i = 0; i < size && i < heaviest.size(); i++)
+      water += heaviest[i];
+    left = ceilUnits(water);
+    return solved;
+  }
+  std::vector<Result> results = solveAll(alone, true);
+  for (size_t i = 0; i < alone.size(); i++)
+    singles[alone[i][0]] = results[i];
+  for (uint32_t e = 0; e < weight.size(); e++) {
+    touched[e] = touches({e, NONE, NONE}, 1, singles[e]);
+    for (uint32_t l : touched[e])
+      users[l].push_back(e);
+    worst[component[e]] = std::max(worst[component[e]], singles[e].lost);
+  }
+
+  std::vector<Combo> overlaps;
+  if (size == 3)
+    neighbours.resize(weight.size());
+  for (uint32_t a = 0; a < weight.size(); a++) {
+    overlapping(touched[a], [&](uint32_t b) {
+      if (b > a && (weight[a] > 0 || weight[b] > 0))
+        overlaps.push_back({a, b, NONE});
+      if (size == 3 && b != a)
+        neighbours[a].emplace_back(b, spill(a, b));
+    });
+    if (size == 3)
+      std::sort(neighbours[a].begin(), neighbours[a].end());
+  }
+  for (const Combo &pair : overlaps) {
+    if (size == 2)
+      offerPair(pair[0], pair[1]);
+    else
+      push({Item::Generator, generatorBound(pair[0], pair[1]), 0, order++, pair});
+  }
+
+  size_t reported = 0;
+  // reports the worst combination found, returning whether k are reported
+  auto next = [&]() {
+    Contingency contingency;
+    for (unsigned i = 0; i < size; i++) {
+      uint32_t e = found.front().combo[i];
+      if (e < pipeCount)
+        contingency.pipes.push_back(e);
+      else
+        contingency.sites.push_back(sites[e - pipeCount]);
+    }
+    contingency.lost = found.front().lost;
+    std::pop_heap(found.begin(), found.end(), smallerLoss);
+    found.pop_back();
+    report(contingency);
+    return ++reported == k;
+  };
+  std::vector<Item> items;
+  std::unordered_set<uint64_t> scheduled;
+  while (true) {
+    uint64_t frontier = pending.empty() ? 0 : pending.front().bound;
+    while (!found.empty() && found.front().lost >= frontier)
+      if (next())
+        return solved;
+    if (frontier == 0)
+      return solved;
+
+    // the batch takes the best items whose scenarios fit in what is left of the budget
+    items.clear();
+    scheduled.clear();
+    size_t cost = 0;
+    bool full = false;
+    while (items.size() < BATCH * pool.size() && !pending.empty() &&
+           (found.empty() || found.front().lost < pending.front().bound)) {
+      std::pop_heap(pending.begin(), pending.end(), lowerBound);
+      if (pending.back().bound < threshold()) {
+        pending.pop_back();
         continue;
       }
-      // temporarily inactivate edge
-      double originalWeight = e->getWeight();
-      e->setWeight(0);
-
-      bool isBidirectional = e->getReverse() != nullptr;
-      if (isBidirectional) {
-        e->getReverse()->setWeight(0);
+      size_t scenarios = this->scenarios(pending.back(), scheduled);
+      if (solved + cost + scenarios > budget) {
+        std::push_heap(pending.begin(), pending.end(), lowerBound);
+        full = true;
+        break;
       }
+      cost += scenarios;
+      items.push_back(pending.back());
+      pending.pop_back();
+    }
+    if (full && items.empty()) {
+      // the combinations found so far are reported anyway, worst first, with the bound of the others
+      left = pending.front().bound;
+      while (!found.empty())
+        if (next())
+          break;
+      return solved;
+    }
+    process(items);
+  }
+}
 
-      std::unordered_map<uint16_t, uint32_t> newMaxFlows = maxFlowCity();
+size_t Data::contingencies(unsigned size, size_t k, size_t budget,
+                           const std::function<void(const Contingency &)> &report, uint64_t &left) {
+  left = 0;
+  if (size < 2 || size > 3 || k == 0)
+    return 0;
+  solveNetwork();
+  return std::visit([&](auto &net) {
+    using F = typename std::decay_t<decltype(net)>::Flow;
+    limitCities(net, true);
+    size_t solved = ContingencySearch<F>(*this, net, size).run(k, budget, report, left);
+    limitCities(net, false);
+    return solved;
+  }, network);
+}
 
-      EdgeKey key;
-      std::string codeA =
-          Utils::parseId(v->getInfo().getKind(), v->getInfo().getId());
-      std::string codeB = Utils::parseId(e->getDest()->getInfo().getKind(),
-                                         e->getDest()->getInfo().getId());
+std::optional<float> Data::getFailure(const Edge<Info> *pipe) const {
+  auto it = pipeFailures.find(pipe);
+  return it == pipeFailures.end() ? std::nullopt : std::optional<float>(it->second);
+}
 
-      if (isBidirectional) { // order the pair
-        key = (codeA < codeB) ? std::make_pair(codeA, codeB)
-                              : std::make_pair(codeB, codeA);
-      } else {
-        key = std::make_pair(codeA, codeB);
-      }
+std::optional<float> Data::getFailure(const Vertex<Info> *station) const {
+  auto it = stationFailures.find(station);
+  return it == stationFailures.end() ? std::nullopt : std::optional<float>(it->second);
+}
 
-      pipeImpactMap[key] = newMaxFlows;
+float Data::getCost(const Edge<Info> *pipe) const {
+  auto it = pipeCosts.find(pipe);
+  return it == pipeCosts.end() ? 0 : it->second;
+}
+
+Reliability Data::simulate(double failure, size_t maxSamples, uint64_t seed) {
+  // samples between two checks of the confidence interval (fixed, so that the stopping point does not depend on
+  // the number of threads)
+  constexpr size_t BATCH = 1024;
+  // samples that lose water before the interval is trusted, and its half-width at which the simulation stops
+  constexpr size_t MIN_EVENTS = 100;
+  constexpr double TOLERANCE = 0.01;
+  // quantile of the normal distribution of a 95% confidence interval
+  constexpr double Z = 1.959963984540054;
+
+  Reliability result;
+  solveNetwork();
+  std::visit([&](auto &net) {
+    using F = typename std::decay_t<decltype(net)>::Flow;
+    size_t cities = getCities().size();
+    std::vector<F> base(cities);
+    for (size_t i = 0; i < cities; i++) {
+      base[i] = net.getFlow(cityLink(i));
+      double demand = getCities()[i]->getInfo().getCap().value();
+      result.baseline.push_back(std::max(0.0, demand - static_cast<double>(base[i])));
+    }
+
+    // the elements that can fail (the pipes by id, then the stations), grouped by the power of two below their
+    // probability: in a group, candidates are drawn with twice that power and each is kept with the ratio of
+    // its probability to it, so only about two draws are made per failure
+    uint32_t pipeCount = pipes.size();
+    std::vector<const Vertex<Info> *> stations;
+    std::map<int, std::vector<std::pair<uint32_t, double>>> groups;
+    auto add = [&groups](uint32_t e, double probability) {
+      if (probability > 0)
+        groups[std::ilogb(probability)].emplace_back(e, probability);
+    };
+    for (uint32_t l = 0; l < pipeCount; l++)
+      add(l, getFailure(pipes[l]).value_or(failure));
+    for (const Vertex<Info> *v : getPumps()) {
+      add(pipeCount + stations.size(), getFailure(v).value_or(failure));
+      stations.push_back(v);
+    }
+    if (groups.empty())
+      return;
 
-      e->setWeight(originalWeight);
-      e->setSelected(true);
+    // the failures of a sample are a function of the seed and of the number of the sample only
+    Philox random(seed);
+    auto sample = [&groups, &random](uint64_t s, std::vector<uint32_t> &failed) {
+      failed.clear();
+      uint32_t g = 0;
+      for (const auto &[exponent, members] : groups) {
+        double rate = std::min(1.0, std::ldexp(1.0, exponent + 1));
+        double logNone = std::log1p(-rate);
+        size_t next = 0;
+        for (uint32_t draw = 0;; draw++) {
+          auto [gap, keep] = random.uniform({static_cast<uint32_t>(s), static_cast<uint32_t>(s >> 32), g, draw});
+          // geometric gap between two candidates (none is skipped if every element is a candidate)
+          double skipped = rate == 1 ? 0 : std::floor(std::log(gap) / logNone);
+          if (skipped >= static_cast<double>(members.size() - next))
+            break;
+          next += static_cast<size_t>(skipped);
+          if (keep * rate <= members[next].second)
+            failed.push_back(members[next].first);
+          next++;
+        }
+        g++;
+      }
+    };
 
-      if (isBidirectional) {
-        e->getReverse()->setWeight(originalWeight);
-        e->getReverse()->setSelected(true);
+    // each thread evaluates its samples on its own copy of the baseline, like the sweeps
+    limitCities(net, true);
+    ThreadPool pool;
+    std::vector<FlowNetwork<F>> copies(pool.size());
+    std::vector<char> prepared(pool.size(), 0);
+    std::vector<std::vector<uint32_t>> failed(pool.size());
+    auto evaluate = [&](unsigned thread, uint64_t s, std::vector<std::pair<uint32_t, double>> &lost) {
+      lost.clear();
+      sample(s, failed[thread]);
+      if (failed[thread].empty())
+        return;
+      QueryWorkspace &ws = workspace();
+      auto &engine = std::get<SolverSet<F>>(ws.solvers).incremental();
+      auto &reroute = std::get<Reroute<F>>(ws.reroutes);
+      FlowNetwork<F> &copy = copies[thread];
+      if (!prepared[thread]) {
+        copy = net;
+        engine.solve(copy);
+        engine.save(copy);
+        prepared[thread] = 1;
+      }
+      auto change = [&](auto &changer, bool remove) {
+        for (uint32_t e : failed[thread]) {
+          if (e < pipeCount)
+            changePipe(copy, changer, e, remove);
+          else
+            changeSite(copy, changer, stations[e - pipeCount], remove);
+        }
+      };
+      reroute.begin(copy);
+      change(reroute, true);
+      bool rerouted = reroute.route(copy, REROUTE_BUDGET);
+      reroute.undo(copy);
+      if (rerouted)
+        return;
+      change(engine, true);
+      engine.resume(copy);
+      for (uint32_t i = 0; i < cities; i++) {
+        double water = static_cast<double>(base[i]) - static_cast<double>(copy.getFlow(cityLink(i)));
+        if (water > 0)
+          lost.emplace_back(i, water);
       }
+      change(engine, false);
+      engine.restore(copy);
+    };
+
+    auto margin = [](double sum, double squares, size_t n) {
+      if (n < 2)
+        return 0.0;
+      double variance = std::max(0.0, (squares - sum * sum / static_cast<double>(n)) / static_cast<double>(n - 1));
+      return Z * std::sqrt(variance / static_cast<double>(n));
+    };
+    std::vector<std::vector<std::pair<uint32_t, double>>> losses(BATCH);
+    std::vector<double> sum(cities, 0), squares(cities, 0);
+    double total = 0, totalSquares = 0;
+    size_t events = 0;
+    while (result.samples < maxSamples && !result.converged) {
+      size_t count = std::min(BATCH, maxSamples - result.samples);
+      uint64_t first = result.samples;
+      pool.run(count, [&](unsigned thread, size_t i) { evaluate(thread, first + i, losses[i]); });
+      // added up in the order of the samples, so that the sums do not depend on the threads either
+      for (size_t i = 0; i < count; i++) {
+        double water = 0;
+        for (auto [c, lost] : losses[i]) {
+          sum[c] += lost;
+          squares[c] += lost * lost;
+          water += lost;
+        }
+        total += water;
+        totalSquares += water * water;
+        events += water > 0;
+      }
+      result.samples += count;
+      double mean = total / static_cast<double>(result.samples);
+      result.converged = events >= MIN_EVENTS && margin(total, totalSquares, result.samples) <= TOLERANCE * mean;
     }
-  }
-  return pipeImpactMap;
+    limitCities(net, false);
+    if (result.samples == 0)
+      return;
+
+    double n = static_cast<double>(result.samples);
+    for (size_t i = 0; i < cities; i++) {
+      result.expected.push_back(result.baseline[i] + sum[i] / n);
+      result.margin.push_back(margin(sum[i], squares[i], result.samples));
+    }
+    result.total = total / n;
+    result.totalMargin = margin(total, totalSquares, result.samples);
+  }, network);
+  if (result.expected.empty())
+    result.expected = result.baseline;
+  result.margin.resize(result.expected.size(), 0);
+  for (double deficit : result.baseline)
+    result.total += deficit;
+  return result;
 }
 
-std::tuple<double, double, double> Data::pipeMetrics() {
-  double avg = 0;
-  double variance = 0;
-  double max = 0;
-  int count = 0;
-  for (Vertex<Info> *v : g.getVertexSet()) {
-    for (Edge<Info> *e : v->getAdj()) {
-      if (e->getFlow() > 0) {
-        double diff = e->getWeight() - e->getFlow();
-        avg += diff;
-        max = std::max(max, diff);
-        count++;
+std::vector<CurvePoint> Data::flowCurve(Scaling scaling) {
+  solveNetwork();
+  std::vector<CurvePoint> curve;
+  std::visit([&](const auto &net) {
+    using F = typename std::decay_t<decltype(net)>::Flow;
+    // the scaled capacities are fractional, so the curve is solved on a copy with double flows, starting from
+    // the baseline max flow (factor 1)
+    FlowNetwork<double> copy(net);
+    const std::vector<Vertex<Info> *> &sites = scaling == Scaling::Demand ? getCities() : getReservoirs();
+    uint32_t firstLink = scaling == Scaling::Demand ? cityLink(0) : pipes.size();
+    uint32_t reservoirLink = pipes.size();
+
+    // the links of the active sites, with their capacity at factor 1
+    std::vector<std::pair<uint32_t, double>> scaled;
+    double total = 0, smallest = std::numeric_limits<double>::infinity(), supply = 0;
+    for (uint32_t l = firstLink; l < firstLink + sites.size(); l++) {
+      if (copy.isActive(copy.getOrig(l)) && copy.isActive(copy.getDest(l)) && copy.getCapacity(l) > 0) {
+        scaled.emplace_back(l, copy.getCapacity(l));
+        total += copy.getCapacity(l);
+        smallest = std::min(smallest, copy.getCapacity(l));
       }
     }
-  }
-  avg /= count;
-    for (Vertex<Info> *v : g.getVertexSet()) {
-        for (Edge<Info> *e : v->getAdj()) {
-            if (e->getFlow() > 0) {
-                double diff = e->getWeight() - e->getFlow();
-                variance += (avg-diff)*(avg-diff);
-            }
+    for (uint32_t l = reservoirLink; l < reservoirLink + getReservoirs().size(); l++)
+      if (copy.isActive(copy.getDest(l)))
+        supply += copy.getCapacity(l);
+    // flows and slopes closer than this are the same (they are sums of the data, rounded on the way)
+    const double eps = 1e-9 * std::max(1.0, supply), slopeEps = 1e-9 * std::max(1.0, total);
+
+    // the capacities are rounded to a power of two small enough for the largest of them: sums and differences
+    // of its multiples are exact, so the engine never chases rounding leftovers (the flows of an integral
+    // network already are multiples of it; a fractional one starts from no flow)
+    double largest = supply;
+    for (uint32_t l = 0; l < copy.getNumLinks(); l++)
+      largest = std::max(largest, copy.getCapacity(l));
+    int exponent = std::ilogb(std::max(1.0, largest)) + 3 - std::numeric_limits<double>::digits;
+    auto toGrid = [exponent](double x) { return std::ldexp(std::round(std::ldexp(x, -exponent)), exponent); };
+    if constexpr (!std::is_integral_v<F>) {
+      copy.clearFlow();
+      for (uint32_t l = 0; l < copy.getNumLinks(); l++)
+        copy.setCapacity(l, toGrid(copy.getCapacity(l)));
+      for (auto &[l, capacity] : scaled)
+        capacity = copy.getCapacity(l);
+    }
+
+    auto &engine = std::get<SolverSet<double>>(workspace().solvers).incremental();
+    engine.solve(copy);
+    std::vector<uint32_t> queue(copy.getNumVertex());
+    std::vector<char> fromSource(copy.getNumVertex()), toSink(copy.getNumVertex());
+    // vertexes that reach (or, backwards, are reached from) a terminal in the residual network
+    auto reach = [&copy, &queue](uint32_t root, bool forward, std::vector<char> &seen) {
+      std::fill(seen.begin(), seen.end(), 0);
+      uint32_t head = 0, tail = 0;
+      queue[tail++] = root;
+      seen[root] = 1;
+      while (head < tail) {
+        uint32_t v = queue[head++];
+        for (uint32_t a = copy.arcBegin(v); a < copy.arcEnd(v); a++) {
+          uint32_t w = copy.arcHead(a);
+          double residual = forward ? copy.residual(a) : copy.residualFrom(copy.arcLink(a), w);
+          if (!seen[w] && copy.isActive(w) && residual > 0) {
+            seen[w] = 1;
+            queue[tail++] = w;
+          }
         }
+      }
+    };
+    // slope of the line of a cut: the scaled capacity that leaves its source side
+    auto slope = [&copy, &scaled](auto inSource) {
+      double b = 0;
+      for (auto [l, capacity] : scaled)
+        if (inSource(copy.getOrig(l)) && !inSource(copy.getDest(l)))
+          b += capacity;
+      return b;
+    };
+
+    // flow at a factor, with the slopes of the curve on its left and on its right
+    struct Point {
+      double factor, flow, left, right;
+    };
+    auto solveAt = [&](double factor) {
+      for (auto [l, capacity] : scaled)
+        engine.setCapacity(copy, l, toGrid(factor * capacity));
+      engine.resume(copy);
+      // the smallest and the largest minimum cuts have the extreme slopes of all the minimum cuts
+      reach(copy.getSource(), true, fromSource);
+      reach(copy.getSink(), false, toSink);
+      double smallestCut = slope([&fromSource](uint32_t v) { return fromSource[v] != 0; });
+      double largestCut = slope([&toSink](uint32_t v) { return toSink[v] == 0; });
+      return Point{factor, copy.value(), std::max(smallestCut, largestCut), std::min(smallestCut, largestCut)};
+    };
+
+    // past this factor, a cut that crosses a city link costs more than the whole supply
+    double end = scaling == Scaling::Demand ? supply / smallest + 1 : 1;
+    if (scaled.empty()) {
+      curve.push_back({0, 0});
+      if (scaling == Scaling::Supply)
+        curve.push_back({end, copy.value()});
+      return;
     }
-  variance /= count;
-  return std::make_tuple(avg, variance, max);
+    Point last = solveAt(end), first = solveAt(0);
+    std::vector<Point> breakpoints;
+    std::vector<std::pair<Point, Point>> intervals = {{first, last}};
+    while (!intervals.empty()) {
+      auto [left, right] = intervals.back();
+      intervals.pop_back();
+      // the line leaving the left end and the line arriving at the right end
+      if (left.right - right.left <= slopeEps)
+        continue;
+      double x = (right.flow - left.flow + left.right * left.factor - right.left * right.factor) /
+                 (left.right - right.left);
+      if (!(x > left.factor && x < right.factor))
+        continue;
+      Point middle = solveAt(x);
+      if (middle.flow >= left.flow + left.right * (x - left.factor) - eps) {
+        // the lines meet on the curve (x is rounded, so the minimum cut may only be one of them)
+        breakpoints.push_back(middle);
+        continue;
+      }
+      // below both lines, the minimum cut at x is a new line that splits the interval
+      if (middle.left - middle.right > slopeEps)
+        breakpoints.push_back(middle);
+      intervals.push_back({left, middle});
+      intervals.push_back({middle, right});
+    }
+    std::sort(breakpoints.begin(), breakpoints.end(),
+              [](const Point &a, const Point &b) { return a.factor < b.factor; });
+    curve.push_back({first.factor, first.flow});
+    for (const Point &p : breakpoints)
+      curve.push_back({p.factor, p.flow});
+    // a demand curve is flat after its last breakpoint
+    if (scaling == Scaling::Supply && (breakpoints.empty() || breakpoints.back().factor < end))
+      curve.push_back({last.factor, last.flow});
+  }, network);
+  return curve;
+}
+
+CostedFlow Data::minCostFlow() {
+  solveNetwork();
+  CostedFlow result;
+  std::visit([&](auto &net) {
+    using F = typename std::decay_t<decltype(net)>::Flow;
+    // a pipe costs the same in both directions, also when it is split in two links at a pump
+    std::vector<double> cost(net.getNumLinks(), 0);
+    for (uint32_t l = 0; l < pipes.size(); l++) {
+      cost[l] = getCost(pipes[l]);
+      if (!reverseLinks.empty() && reverseLinks[l] != FlowNetwork<F>::NONE)
+        cost[reverseLinks[l]] = cost[l];
+    }
+    for (uint32_t l = 0; l < net.getNumLinks(); l++)
+      result.solverCost += cost[l] * std::abs(static_cast<double>(net.getFlow(l)));
+
+    result.cost = std::get<MinCostFlow<F>>(workspace().minCostFlows).solve(net, cost);
+    result.flow = static_cast<double>(net.value());
+    for (size_t i = 0; i < getCities().size(); i++)
+      result.cities.push_back(static_cast<double>(net.getFlow(cityLink(i))));
+    for (size_t l = 0; l < pipes.size(); l++)
+      pipes[l]->setFlow(pipeFlow(net, l));
+  }, network);
+  return result;
+}
+
+template <class F> double Data::pipeFlow(const FlowNetwork<F> &net, uint32_t pipe) const {
+  double flow = static_cast<double>(net.getFlow(pipe));
+  if (!reverseLinks.empty() && reverseLinks[pipe] != FlowNetwork<F>::NONE)
+    flow -= static_cast<double>(net.getFlow(reverseLinks[pipe]));
+  return flow;
 }
 
-std::pair<std::tuple<double, double, double>, std::tuple<double, double, double>> Data::balanceGraph() {
+PipeMetrics Data::pipeMetrics() const {
+  return std::visit([this](const auto &net) {
+    if (reverseLinks.empty())
+      return computePipeMetrics(net.capacityData(), net.flowData(), pipes.size());
+    // some pipes have their flow split in two links
+    std::vector<double> capacity(pipes.size()), flow(pipes.size());
+    for (uint32_t l = 0; l < pipes.size(); l++) {
+      capacity[l] = static_cast<double>(net.getCapacity(l));
+      flow[l] = pipeFlow(net, l);
+    }
+    return computePipeMetrics(capacity.data(), flow.data(), pipes.size());
+  }, network);
+}
+
+std::pair<PipeMetrics, PipeMetrics> Data::balanceGraph() {
     maxFlowCity();
 
     // initial metrics
-    auto [avg, variance, max] = pipeMetrics();
-
-    std::vector<Edge<Info>*> edges;
-    // 1. Coletar todas as arestas com fluxo positivo
-    for (auto v : g.getVertexSet()) {
-        for (auto e : v->getAdj()) {
-            if (e->getFlow() > 0) {
-                edges.push_back(e);
-            }
+    PipeMetrics before = pipeMetrics();
+
+    // working copy of the pipes with flow as parallel arrays: the balanced flows are
+    // not a valid max flow, so they are not written into the network.
+    // undirected pipes have a signed flow: the amount of water is balanced, keeping its direction
+    std::vector<uint32_t> links;
+    std::vector<double> capacity, amount;
+    std::visit([&](const auto &net) {
+      for (uint32_t l = 0; l < pipes.size(); l++) {
+        if (pipeFlow(net, l) != 0) {
+          links.push_back(l);
+          capacity.push_back(static_cast<double>(net.getCapacity(l)));
+          amount.push_back(std::abs(pipeFlow(net, l)));
         }
-    }
-    double delta = sqrt(variance);
+      }
+    }, network);
+    auto metrics = [&]() { return computePipeMetrics(capacity.data(), amount.data(), capacity.size()); };
+
+    // 1. Todas as arestas com fluxo, pela ordem dos índices
+    std::vector<uint32_t> edges(links.size());
+    for (uint32_t k = 0; k < edges.size(); k++)
+        edges[k] = k;
+    double delta = sqrt(before.variance);
     for (int i=0; i<10; i++) {
         // 2. Ordenar as arestas pelo espaço restante (cap - fluxo)
-        std::sort(edges.begin(), edges.end(), [](Edge<Info>* a, Edge<Info>* b) {
-            return (a->getWeight() - a->getFlow()) < (b->getWeight() - b->getFlow());
+        std::sort(edges.begin(), edges.end(), [&](uint32_t a, uint32_t b) {
+            return (capacity[a] - amount[a]) < (capacity[b] - amount[b]);
         });
 
         // 3. Tentar redistribuir o fluxo
-        for (int i = 0; i < edges.size(); i++) {
-            auto edge = edges[i];
-            if (edge->getFlow() >= delta) {
+        for (size_t i = 0; i < edges.size(); i++) {
+            uint32_t edge = edges[i];
+            if (amount[edge] >= delta) {
                 // Procura por uma aresta com espaço suficiente para transferir parte do fluxo
-                for (int j = edges.size() - 1; j > i; j--) {
-                    auto targetEdge = edges[j];
-                    double targetAvailableSpace = targetEdge->getWeight() - targetEdge->getFlow();
+                for (size_t j = edges.size() - 1; j > i; j--) {
+                    uint32_t targetEdge = edges[j];
+                    double targetAvailableSpace = capacity[targetEdge] - amount[targetEdge];
 
                     if (targetAvailableSpace > 0) {
                         // Determina quanto de fluxo pode ser transferido
                         double transferableFlow = std::min(delta, targetAvailableSpace);
 
-                        edge->setFlow(edge->getFlow() - transferableFlow);
-                        targetEdge->setFlow(targetEdge->getFlow() + transferableFlow);
+                        amount[edge] -= transferableFlow;
+                        amount[targetEdge] += transferableFlow;
 
                         break;
                     }
@@ -353,11 +2035,13 @@ std::pair<std::tuple<double, double, double>, std::tuple<double, double, double>
             }
         }
         // new metrics
-        auto [avg2, variance2, max2] = pipeMetrics();
-        delta = sqrt(variance2);
+        delta = sqrt(metrics().variance);
     }
-    auto [avg2, variance2, max2] = pipeMetrics();
-    return std::make_pair(std::make_tuple(avg, variance, max), std::make_tuple(avg2, variance2, max2));
+
+    // 4. Guardar o fluxo balanceado nas arestas
+    for (size_t k = 0; k < links.size(); k++)
+        pipes[links[k]]->setFlow(std::copysign(amount[k], pipes[links[k]]->getFlow()));
+    return std::make_pair(before, metrics());
 }
 
 
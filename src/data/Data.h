@@ -2,23 +2,100 @@
 #define DA2324_PRJ1_G163_DATA_H
 
 #include "../../lib/Graph.h"
+#include "../../lib/GraphBuilder.h"
 #include "../CSV.h"
+#include "../flow/BoykovKolmogorov.h"
+#include "../flow/FlowNetwork.h"
+#include "../flow/PipeMetrics.h"
+#include "../flow/Solvers.h"
 #include "Info.h"
+#include "NodeCode.h"
+#include "PipeIndex.h"
+#include "Snapshot.h"
+#include <array>
 #include <cstdint>
+#include <functional>
 #include <optional>
 #include <string>
+#include <tuple>
+#include <unordered_map>
 #include <variant>
+#include <vector>
 
-/// Hash function for pairs.
-struct pair_hash {
-  template <class T1, class T2>
-  std::size_t operator()(const std::pair<T1, T2> &pair) const {
-    auto hash1 = std::hash<T1>{}(pair.first);
-    auto hash2 = std::hash<T2>{}(pair.second);
-    return hash1 ^ hash2;
-  }
+/**
+ * @brief Part of the minimum cut that limits the supply of a group of cities in deficit.
+ * @details See Data::explainDeficits().
+ */
+struct Bottleneck {
+  /// Saturated pipe, with the direction of its water
+  struct Pipe {
+    Vertex<Info> *from, *to;
+    double capacity;
+  };
+
+  /// Cities in deficit that share the cut (a city is in one group only)
+  std::vector<Vertex<Info> *> cities;
+  /// Cities with enough water that are fed through the same cut
+  std::vector<Vertex<Info> *> sharedWith;
+  /// Pipes that carry their full capacity towards the cities
+  std::vector<Pipe> pipes;
+  /// Reservoirs that deliver their maximum, with their maximum delivery
+  std::vector<std::pair<Vertex<Info> *, double>> reservoirs;
+  /// Pumping stations at their throughput limit, with their limit
+  std::vector<std::pair<Vertex<Info> *, double>> pumps;
+  /// Total capacity of the cut: the most water that can reach the cities behind it (including Bottleneck::sharedWith)
+  double capacity = 0;
+};
+
+/// Simultaneous failure of pipes and sites, with the water it loses (see Data::contingencies())
+struct Contingency {
+  /// Ids of the failed pipes (see Data::getPipe())
+  std::vector<uint32_t> pipes;
+  /// Failed reservoirs and pumping stations
+  std::vector<Vertex<Info> *> sites;
+  /// Water that the cities lose
+  uint64_t lost = 0;
+};
+
+/// Expected unmet demand under random failures of pipes and pumping stations (see Data::simulate())
+struct Reliability {
+  /// Number of failure states sampled
+  size_t samples = 0;
+  /// Whether the confidence interval of the total got tight enough before the limit of samples
+  bool converged = false;
+  /// Unmet demand of each city (in the order of Data::getCities()) without failures
+  std::vector<double> baseline;
+  /// Expected unmet demand of each city, and the half-width of its 95% confidence interval
+  std::vector<double> expected, margin;
+  /// Expected unmet demand of the whole network, and the half-width of its 95% confidence interval
+  double total = 0, totalMargin = 0;
 };
 
+/// Maximum flow of minimum pumping cost (see Data::minCostFlow())
+struct CostedFlow {
+  /// Flow of each city (in the order of Data::getCities())
+  std::vector<double> cities;
+  /// Water delivered: the maximum flow
+  double flow = 0;
+  /// Pumping cost of the cheapest maximum flow
+  double cost = 0;
+  /// Pumping cost of the maximum flow found by the max-flow solver, for comparison
+  double solverCost = 0;
+};
+
+/// What Data::flowCurve() scales: the demand of every city, or the capacity of every reservoir
+enum class Scaling { Demand, Supply };
+
+/// Breakpoint of the delivered flow as a function of a scaling factor (see Data::flowCurve())
+struct CurvePoint {
+  /// Scaling factor
+  double factor;
+  /// Maximum flow delivered to the cities with that factor
+  double flow;
+};
+
+template <class F> class ContingencySearch;
+
 /**
  * @brief Data storage and algorithms execution.
  * @details This class is responsible for storing the data and executing the
@@ -30,41 +107,213 @@ private:
   /// Graph with the data inside Info objects.
   Graph<Info> g;
 
+  /// Vertexes of the graph partitioned by Info::Kind (reservoirs, pumps and cities).
+  std::array<std::vector<Vertex<Info> *>, 3> kinds;
+
+  /**
+   * @brief Fills Data::kinds from the vertexes of the graph.
+   * @note Time complexity: O(V) where V is the number of vertexes in the graph.
+   */
+  void partitionVertexes();
+
+  /// Flow network compiled from the graph, with the narrowest exact flow type for the data (see compileNetwork()).
+  std::variant<FlowNetwork<int32_t>, FlowNetwork<int64_t>, FlowNetwork<double>> network;
+
+  /// Pipe of each link of the flow network. The links of the reservoirs and of the cities come after the pipes.
+  std::vector<Edge<Info> *> pipes;
+
+  /// Id (link of the flow network) of every pipe by its service points.
+  PipeIndex pipeIndex;
+
+  /// Vertex of the graph of each vertex of the flow network. The super source and the super sink (nullptr)
+  /// come after the vertexes of the graph, followed by the second half of every split pump.
+  std::vector<Vertex<Info> *> networkVertexes;
+
+  /**
+   * @brief Second link of each pipe, or FlowNetwork::NONE.
+   * @details A pump with a throughput limit is split in two network vertexes joined by a link with its
+   * capacity. An undirected pipe at a split pump becomes two directed links, one per direction, and the
+   * (signed) flow of the pipe is the flow of its first link minus the flow of the second. Empty if no
+   * pipe was split.
+   */
+  std::vector<uint32_t> reverseLinks;
+
+  /// Signed flow of a pipe in a flow network (see Data::reverseLinks).
+  template <class F> double pipeFlow(const FlowNetwork<F> &net, uint32_t pipe) const;
+
+  /**
+   * @brief Compiles the graph into Data::network.
+   * @details The flow type is `int32_t` when every capacity and demand is an integer and
+   * the total supply fits in 31 bits, `int64_t` when they are integers but larger, and
+   * `double` otherwise (fractional demands).
+   * @note Time complexity: O(V + E) where V is the number of vertexes and E is the number of edges in the graph.
+   */
+  void compileNetwork();
+
+  /// Fills a flow network with the vertexes, pipes, reservoirs and cities of the graph.
+  template <class F> void compileNetwork(FlowNetwork<F> &net);
+
+  /// Link of the flow network between the i-th city (Data::getCities()) and the super sink.
+  uint32_t cityLink(size_t i) const;
+
+  /**
+   * @brief Computes the maximum flow from the reservoirs to the cities from scratch.
+   * @details The active state of every site is read from its Info, and the resulting
+   * flow of every pipe is written back to its Edge.
+   * @note Time complexity: O(V * E^2) where V is the number of vertexes and E is the number of edges in the graph.
+   */
+  void solveMaxFlow();
+
+  /**
+   * @brief Computes the maximum flow like solveMaxFlow(), but leaves the edges untouched.
+   * @details The network is contracted first (see Contraction): the engine solves the core and the
+   * flow is mapped back to every link. The engine, the contraction and their arrays come from the
+   * workspace of the calling thread, so no memory is allocated once the workspace has grown to the
+   * size of the network.
+   */
+  void solveNetwork();
+
+  /// Engine of the full max-flow solves, or nothing until the automatic selection has run (see setSolver()).
+  std::optional<Solver> solver = Solver::EdmondsKarp;
+
+  /**
+   * @brief Profiles every registered engine on a network and selects the fastest.
+   * @details Each engine solves the network from scratch a few times and its best time is kept.
+   * The timings and the choice are reported with info(), so the solver can be pinned.
+   * @note Time complexity: a few max-flow solves per registered engine.
+   */
+  template <class F> void tuneSolver(FlowNetwork<F> &net);
+
+  /// Flow of each city (in the order of getCities()) in the last solution, into a reused vector.
+  void cityFlows(std::vector<uint32_t> &flows) const;
+
+  /**
+   * @brief Cities whose flow changed between the baseline and the scenario of the thread workspace.
+   * @param decreasedOnly: If true, only the cities with less flow are listed.
+   * @return A vector with the city id, the old flow and the new flow.
+   */
+  std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> cityImpact(bool decreasedOnly) const;
+
+  /// Whether any city flow changed between the baseline and the scenario of the thread workspace (see cityImpact()).
+  bool hasImpact(bool decreasedOnly) const;
+
+  /// Water that the cities lose between the baseline and the scenario of the thread workspace (see cityImpact()).
+  uint64_t lostFlow() const;
+
+  /**
+   * @brief Limits the flow of every city to its flow in the network (the baseline of the scenarios), or back to its demand.
+   * @details In the scenarios a city is affected only if its baseline flow can no longer be delivered,
+   * whatever max flow the engine finds.
+   */
+  template <class F> void limitCities(FlowNetwork<F> &net, bool toBaseline) const;
+
+  /// Network vertexes of each reservoir and pump (the second is FlowNetwork::NONE unless the pump is split).
+  std::unordered_map<const Vertex<Info> *, std::pair<uint32_t, uint32_t>> siteVertexes;
+
   /**
-   * @brief Sets the parsed Cities.csv in the graph.
+   * @brief Evaluates a sequence of what-if scenarios against the current network.
+   * @details The baseline is solved once (the same flow as maxFlowCity()) and its city flows are kept
+   * in the thread workspace. Every scenario is first tried locally: `change(net, reroute, i, true)`
+   * applies scenario i through a Reroute, and if the water of the changed pipes or sites can be sent
+   * around them within a small search, no city is affected and the change is simply undone.
+   * Otherwise the scenario starts from the saved baseline search trees of the Boykov-Kolmogorov
+   * engine: `change(net, engine, i, true)` applies it through the engine, the flow is made maximum
+   * again incrementally, the city flows go to the workspace and `change(net, engine, i, false)`
+   * undoes the change in the network. Then `result(i)` reads the city flows, and returning false ends the sweep.
+   * Every scenario starts from the same state, so its result does not depend on the others.
+   * @param solved: If true, the network already holds the baseline (the last solveNetwork()), so it is not solved again.
    */
-  void setCities(Csv cities);
+  template <class Change, class Result>
+  void sweep(size_t scenarios, Change change, Result result, bool solved = false);
+
+  /// Removes (disables) a site through the engine (BoykovKolmogorov or Reroute), or enables it back in the network.
+  template <class F, class Engine>
+  void changeSite(FlowNetwork<F> &net, Engine &engine, const Vertex<Info> *site, bool remove);
+
+  /// Removes a pipe through the engine (BoykovKolmogorov or Reroute), or restores its capacity in the network.
+  template <class F, class Engine> void changePipe(FlowNetwork<F> &net, Engine &engine, uint32_t pipe, bool remove);
+
+  template <class F> friend class ContingencySearch;
+
+  /// Failure probability of the pipes and pumping stations with a value in the optional Failure column of
+  /// Pipes.csv and Stations.csv (see simulate())
+  std::unordered_map<const Edge<Info> *, float> pipeFailures;
+  std::unordered_map<const Vertex<Info> *, float> stationFailures;
+  /// Pumping cost per unit of water of the pipes with a value in the optional Cost column of Pipes.csv (see minCostFlow())
+  std::unordered_map<const Edge<Info> *, float> pipeCosts;
 
   /**
-   * @brief Sets the parsed Pipes.csv in the graph.
+   * @brief Queues the parsed Cities.csv in the graph builder.
    */
-  void setPipes(Csv pipes);
+  void setCities(Csv cities, GraphBuilder<Info> &builder);
 
   /**
-   * @brief Sets the parsed Reservoir.csv in the graph.
+   * @brief Queues the parsed Pipes.csv in the graph builder.
+   * @details The endpoints are looked up in the vertexes already queued, in constant time.
+   * @param failures: Filled with the index in the builder and the failure probability of each pipe that has one
+   * @param costs: Filled with the index in the builder and the pumping cost of each pipe that has one
    */
-  void setReservoirs(Csv reservoirs);
+  void setPipes(Csv pipes, GraphBuilder<Info> &builder, std::vector<std::pair<size_t, float>> &failures,
+                std::vector<std::pair<size_t, float>> &costs);
 
   /**
-   * @brief Sets the parsed Stations.csv in the graph.
+   * @brief Queues the parsed Reservoir.csv in the graph builder.
    */
-  void setStations(Csv stations);
+  void setReservoirs(Csv reservoirs, GraphBuilder<Info> &builder);
+
+  /**
+   * @brief Queues the parsed Stations.csv in the graph builder.
+   * @param failures: Filled with the index in the builder and the failure probability of each station that has one
+   */
+  void setStations(Csv stations, GraphBuilder<Info> &builder, std::vector<std::pair<size_t, float>> &failures);
 
 public:
   /**
    * @brief Constructor
+   * @param order: Layout of the vertexes in memory. VertexOrder::BFS starts at the reservoirs, so the vertexes
+   * are stored in the order the flow algorithms reach them.
+   */
+  Data(Csv cities, Csv pipes, Csv reservoirs, Csv stations, VertexOrder order = VertexOrder::Insertion);
+
+  /**
+   * @brief Constructor from a compiled snapshot
+   * @details Rebuilds the graph directly from the tables of the snapshot.
+   * @note Time complexity: O(V + E) where V is the number of vertexes and E is
+   * the number of edges in the graph.
+   * @param order: Layout of the vertexes in memory (a snapshot keeps the layout it was written with).
+   */
+  explicit Data(const Snapshot &snapshot, VertexOrder order = VertexOrder::Insertion);
+
+  /**
+   * @brief Chooses the max-flow engine of the queries.
+   * @details Without an engine (automatic selection), the engines are profiled on the network
+   * by the first query that solves it (see tuneSolver()). The sweeps of the removal queries
+   * always solve their scenarios incrementally; the engine only computes their baseline.
    */
-  Data(Csv cities, Csv pipes, Csv reservoirs, Csv stations);
+  void setSolver(std::optional<Solver> engine);
 
   /**
    * @brief Getter for the graph
    */
   Graph<Info> &getGraph();
 
+  /**
+   * @brief Vertexes of a given kind, stored contiguously.
+   * @param kind: Info::Kind::Reservoir, Info::Kind::Pump or Info::Kind::City
+   */
+  const std::vector<Vertex<Info> *> &getVertexes(Info::Kind kind) const;
+
+  /// Every reservoir of the network
+  const std::vector<Vertex<Info> *> &getReservoirs() const;
+  /// Every pumping station of the network
+  const std::vector<Vertex<Info> *> &getPumps() const;
+  /// Every city of the network
+  const std::vector<Vertex<Info> *> &getCities() const;
+
   /**
    * @brief Number of cities, reservoirs and pumps.
    * @details Useful for debug.
-   * @note Time complexity: O(V) where V is the number of vertexes in the graph.
+   * @note Time complexity: O(1).
    * @return An array with the number of cities, reservoirs and pumps vertexes,
    * respectively.
    */
@@ -72,38 +321,152 @@ public:
 
   /**
    * @brief Maximum amount of water that can reach every city of the graph
-   * @details Uses the Edmonds-Karp algorithm to calculate the maximum flow of
-   * the graph.
-   * @note Time complexity: O(V * E^2) where V is the number of vertexes and E
-   * is the number of edges in the graph.
+   * @details Solves the contracted network (see solveNetwork()) with the engine chosen by
+   * `--solver` (see setSolver()): Edmonds-Karp or Boykov-Kolmogorov, or the faster of the
+   * two on this network when the engine is selected automatically (see tuneSolver()).
+   * @note Time complexity: O(V * E^2) with Edmonds-Karp and O(V^2 * E * C) with
+   * Boykov-Kolmogorov, where V is the number of vertexes, E is the number of edges and
+   * C is the maximum flow of the graph. The automatic selection adds a few solves per engine,
+   * only on the first query.
    * @return A map with the city id and the maximum flow that can reach it.
    */
-  std::unordered_map<uint16_t, uint32_t> maxFlowCity();
+  std::unordered_map<uint32_t, uint32_t> maxFlowCity();
 
   /**
    * @brief Impact in each city of removing a site (reservoir or pump)
    * @details Calculates the flow arriving at each city after inactivating a
-   * site (reservoir or pump).
+   * site (reservoir or pump). The baseline is the flow of maxFlowCity(); the
+   * scenario is solved incrementally from it by the Boykov-Kolmogorov engine, so
+   * only the flow through the site is rerouted.
    * @return vector with the affected cities.
    * @note O(V * E^2) 
    **/
-  std::vector<std::tuple<uint16_t, uint32_t, uint32_t>>
+  std::vector<std::tuple<uint32_t, uint32_t, uint32_t>>
   removeSite(Vertex<Info>* tgt);
+
+  /**
+   * @brief Sites (reservoirs or pumps) that can be removed without reducing the flow of any city
+   * @details The scenarios are solved incrementally from one baseline (see removeSite()).
+   * @return The removable sites, in the given order.
+   */
+  std::vector<Vertex<Info> *> removableSites(const std::vector<Vertex<Info> *> &sites);
   
   /**
-   * @brief Impact in each city of removing each pipe
-   * @details Calculates the flow arriving at each city after removing each
-   * pipe.
+   * @brief Pipes that can be removed without changing the flow of any city
+   * @details Solves the network once without each pipe and compares the flow of
+   * every city with the baseline. Every scenario is solved incrementally from the
+   * baseline search trees, reusing the workspace of the thread, and does not allocate memory.
    * @note Time complexity: O(V * E^3) where V is the number of vertexes
    * and E is the number of edges in the graph.
-   * @return A map with the pair of the source and destination vertexes of the
-   * removed pipes and a vector of pairs with the city id and the resulting
-   * flow.
+   * @return The ids of the removable pipes (see getPipe()).
    */
-  std::unordered_map<std::pair<std::string, std::string>,
-                     std::unordered_map<uint16_t, uint32_t>, pair_hash>
-  removingPipes();
+  std::vector<uint32_t> removablePipes();
 
+  /**
+   * @brief Impact in each city of removing one pipe
+   * @details Calculates the flow arriving at each city without the pipe. The pipe is restored afterwards.
+   * @note Time complexity: O(V * E^2) where V is the number of vertexes and E is the number of edges in the graph.
+   * @param pipe: Id of the pipe (see findPipe())
+   * @return A vector with the id, the old flow and the new flow of the cities whose flow changes.
+   */
+  std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> removingPipe(uint32_t pipe);
+
+  /**
+   * @brief The pipes whose removal loses the most water, with branch and bound.
+   * @details A pipe cannot lose more water than it carries in the baseline, so the pipes are evaluated
+   * (like removingPipe()) in decreasing order of baseline flow, and the search stops once the k-th
+   * largest loss found is at least the flow of the next pipe. Pipes without loss are not listed;
+   * equal losses keep the order of evaluation.
+   * @note Time complexity: one incremental solve per evaluated pipe, usually a small fraction of them.
+   * @param k: Number of pipes to list
+   * @param evaluated: Set to the number of pipes that were evaluated
+   * @return Up to k pipe ids (see getPipe()) with the water lost without them, from the largest loss.
+   */
+  std::vector<std::pair<uint32_t, uint64_t>> topPipes(size_t k, size_t &evaluated);
+
+  /**
+   * @brief N-k contingency analysis: the simultaneous failures of pipes and sites that lose the most water.
+   * @details Only the combinations whose failures *interact* are reported: together they lose more water
+   * than any one of them on its own plus the others (for a pair, more than the sum of their losses). The
+   * scenarios are solved from the baseline in parallel, and the combinations that cannot interact or
+   * cannot beat the ones found are pruned without solving them (see ContingencySearch).
+   * @param size: Number of simultaneous failures (2 or 3)
+   * @param k: Maximum number of combinations to report
+   * @param budget: Most scenarios solved, the failures alone included
+   * @param report: Called with each combination as soon as no combination left can lose more water, so the
+   * worst combinations come first. If the budget runs out, the combinations found so far follow, worst first.
+   * @param left: Set to the most water that a combination not reported can lose if the budget ran out
+   * before k combinations were reported, otherwise to 0
+   * @return The number of scenarios solved.
+   */
+  size_t contingencies(unsigned size, size_t k, size_t budget, const std::function<void(const Contingency &)> &report,
+                       uint64_t &left);
+
+  /**
+   * @brief Finds the pipe that carries water from one service point to another.
+   * @details That is, the unidirectional pipe from orig to dest or the bidirectional pipe between them.
+   * @note Time complexity: O(1) on average.
+   * @return The id of the pipe, or PipeIndex::NONE if there is none.
+   */
+  uint32_t findPipe(NodeCode orig, NodeCode dest) const { return pipeIndex.find(orig, dest); }
+
+  /// Edge of the pipe with the given id (see findPipe())
+  Edge<Info> *getPipe(uint32_t pipe) const { return pipes[pipe]; }
+
+  /// Number of pipes (the ids of the pipes are [0, getPipeCount()))
+  uint32_t getPipeCount() const { return pipes.size(); }
+
+  /// Failure probability of a pipe from Pipes.csv, if it has one
+  std::optional<float> getFailure(const Edge<Info> *pipe) const;
+
+  /// Failure probability of a pumping station from Stations.csv, if it has one
+  std::optional<float> getFailure(const Vertex<Info> *station) const;
+
+  /// Pumping cost per unit of water of a pipe from Pipes.csv (0 if it has none)
+  float getCost(const Edge<Info> *pipe) const;
+
+  /**
+   * @brief Monte Carlo estimate of the unmet demand of each city when pipes and pumping stations fail at random.
+   * @details Every sample fails each pipe and station independently with its probability, and the failures are
+   * evaluated like a removal scenario: rerouted locally if possible, otherwise solved incrementally from the
+   * baseline (so a city never gets more than its baseline flow). The unmet demand of a city is its deficit
+   * without failures (as in meetsWaterNeeds()) plus the water it loses. The samples run on every core, and the
+   * random numbers come from a counter-based generator (Philox) keyed by the seed and numbered by sample, so the
+   * result does not depend on the number of threads. The simulation stops early once the 95% confidence
+   * interval of the total water lost is within 1% of its mean.
+   * @note Time complexity: one local reroute or incremental solve per sample with failures.
+   * @param failure: Failure probability of the pipes and stations without a value in the Failure column
+   * @param maxSamples: Maximum number of samples
+   * @param seed: Seed of the random numbers
+   */
+  Reliability simulate(double failure, size_t maxSamples, uint64_t seed);
+
+  /**
+   * @brief Parametric max flow: the water delivered when every city demand, or every reservoir capacity, is
+   * multiplied by the same factor.
+   * @details The delivered flow is the minimum over the cuts of a line in the factor, so it is concave and
+   * piecewise linear, and its breakpoints are found exactly by intersecting the lines of the cuts (Eisner and
+   * Severance): the max flow is solved at the intersection of the lines found on both sides of an interval,
+   * and either it is on both (a breakpoint) or its minimum cut is a new line that splits the interval. Each
+   * factor is solved incrementally from the flow of the previous one, with fractional capacities. Curves with
+   * Scaling::Demand go from factor 0 up to the factor after which nothing more is delivered; curves with
+   * Scaling::Supply go from 0 to 1 (a drought).
+   * @note Time complexity: two incremental solves per breakpoint, and there are at most as many breakpoints as
+   * scaled cities or reservoirs.
+   * @return The breakpoints from factor 0, with the end of the curve: the flow is linear between two of them.
+   */
+  std::vector<CurvePoint> flowCurve(Scaling scaling);
+
+  /**
+   * @brief The cheapest way of delivering the maximum flow, with the pumping cost of each pipe.
+   * @details Every unit of water through a pipe costs its value in the Cost column of Pipes.csv, in either
+   * direction (reservoirs, cities and pumping stations cost nothing). The max flow of maxFlowCity() is made
+   * cheaper with cost scaling (see MinCostFlow), and is kept in the network and in the pipes like the flow of
+   * maxFlowCity(), so the other queries see it until they solve again.
+   * @note Time complexity: O(V^2 E log(V C)) where V is the number of vertexes, E is the number of edges in the
+   * graph and C is the largest cost, with O(log(V C)) phases whatever the number of distinct costs.
+   */
+  CostedFlow minCostFlow();
 
   /**
    * @brief Cities with not enough flow for their demand
@@ -117,24 +480,38 @@ public:
    */
   std::vector<std::pair<Info, int32_t>> meetsWaterNeeds();
 
+  /**
+   * @brief Why the cities in deficit cannot get more water, from the flow of the last meetsWaterNeeds().
+   * @details No extra max flow is solved. In the residual network of the last flow, every vertex that
+   * could still send water to a city in deficit (never through the super sink) is found with one
+   * backward search from all those cities at once. Cities whose regions overlap compete for the same
+   * water, so they are joined in one group (UFDS). The links that enter the region of a group at full
+   * capacity (pipes, pumps at their limit, and reservoirs delivering their maximum) form its cut.
+   * @note Time complexity: O(V + E) where V is the number of vertexes and E is the number of edges in the graph
+   * (times the inverse Ackermann function of the number of cities).
+   * @return One bottleneck per group, ordered by the code of the first city of each group.
+   */
+  std::vector<Bottleneck> explainDeficits();
+
   /**
    * @brief Calculates the metrics of the network
    * @details Calculates the average, the variance and the maximum value
-   * of the difference between the edges capacity and the flow.
+   * of the difference between the pipes capacity and the flow of the last max flow,
+   * in a single pass over the contiguous link arrays of the flow network.
    * @note Time complexity: O(E) where E is the number of edges in the graph.
-   * @return a tuple with the average, the variance and the maximum value.
+   * @return the average, the variance and the maximum value.
    */
-  std::tuple<double, double, double> pipeMetrics();
+  PipeMetrics pipeMetrics() const;
 
   /**
    * @brief Balances the graph
    * @details Redistribution of the flow from edges with less remaining space
-   * to edges with more remaining space.
+   * to edges with more remaining space. The balancing works on a contiguous copy
+   * of the capacities and flows; the result is stored in the edges only.
    * @note Time complexity: O(V * E^2) where V is the number of vertexes and E is the number of edges in the graph.
-   * @return a pair of tuples with the average, the variance and the maximum value,
-   * before and after the balance.
+   * @return the average, the variance and the maximum value, before and after the balance.
    */
-  std::pair<std::tuple<double, double, double>, std::tuple<double, double, double>> balanceGraph();
+  std::pair<PipeMetrics, PipeMetrics> balanceGraph();
 };
 
 #endif // DA2324_PRJ1_G163_DATA_H
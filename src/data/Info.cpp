@@ -1,57 +1,91 @@
 #include "Info.h"
+#include "NodeCode.h"
+#include <cmath>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable_v<Info>, "Info must stay a small POD");
+static_assert(sizeof(Info) == 16, "Update the memory budget in docs/docs.md");
+
+std::deque<Info::Details> &Info::detailsTable() {
+  static std::deque<Details> table;
+  return table;
+}
 
 Info::Kind Info::getKind() const {
   return kind;
 }
 
-uint16_t Info::getId() const {
+uint32_t Info::getId() const {
   return id;
 }
 
-const std::variant<Info::ReservoirData, Info::PumpData, Info::CityData> &Info::getData() const {
-  return data;
+NodeCode Info::getCode() const {
+  return {kind, id};
 }
 
-Info::Info(Info::Kind kind, uint16_t id, const std::variant<ReservoirData, PumpData, CityData> &data) : kind(kind), id(id), data(data), is_active(true) {}
+const Info::Details &Info::getDetails() const {
+  static const Details empty;
+  if (details == NO_DETAILS)
+    return empty;
+  return detailsTable()[details];
+}
 
-std::optional<float> Info::getCap() const {
-  switch (getKind()) {
-    case Pump:
-      return {};
-    case Reservoir:
-      return std::get<ReservoirData>(getData()).cap;
-    case City:
-      return std::get<CityData>(getData()).cap;
+Info::Info(Info::Kind kind, uint32_t id, const std::variant<ReservoirData, PumpData, CityData> &data)
+    : cap(0), details(NO_DETAILS), id(id), kind(kind), storage(CapStorage::Whole), is_active(true) {
+  std::deque<Details> &table = detailsTable();
+  if (const auto *r = std::get_if<ReservoirData>(&data)) {
+    cap = r->cap;
+    details = table.size();
+    table.push_back({r->location, r->municipality, 0});
+  } else if (const auto *c = std::get_if<CityData>(&data)) {
+    details = table.size();
+    table.push_back({c->location, StringPool::EMPTY, c->population});
+    // the demands are checked to fit in 32 bits
+    if (c->cap == std::floor(c->cap)) {
+      cap = static_cast<uint32_t>(c->cap);
+    } else {
+      storage = CapStorage::Fraction;
+      table.back().demand = c->cap;
+    }
+  } else if (const auto *p = std::get_if<PumpData>(&data)) {
+    if (p->cap.has_value())
+      cap = p->cap.value();
+    else
+      storage = CapStorage::Unlimited;
   }
 }
 
-std::optional<std::string> Info::getLocation() const {
-  switch (getKind()) {
-    case Pump:
-      return {};
-    case Reservoir:
-      return std::get<ReservoirData>(getData()).location;
-    case City:
-      return std::get<CityData>(getData()).location;
+std::optional<double> Info::getCap() const {
+  switch (storage) {
+  case CapStorage::Whole:
+    return cap;
+  case CapStorage::Fraction:
+    return getDetails().demand;
+  default:
+    return {};
   }
 }
 
+std::string_view Info::getLocation() const {
+  return StringPool::global().view(getDetails().location);
+}
+
+StringPool::Symbol Info::getLocationId() const {
+  return getDetails().location;
+}
+
 std::optional<uint32_t> Info::getPopulation() const {
-  switch (getKind()) {
-    case City:
-      return std::get<CityData>(getData()).population;
-    default:
-      return {};
-  }
+  if (kind != City)
+    return {};
+  return getDetails().population;
 }
 
-std::optional<std::string> Info::getMunicipality() const {
-  switch (getKind()) {
-    case Reservoir:
-      return std::get<ReservoirData>(getData()).municipality;
-    default:
-      return {};
-  }
+std::string_view Info::getMunicipality() const {
+  return StringPool::global().view(getDetails().municipality);
+}
+
+StringPool::Symbol Info::getMunicipalityId() const {
+  return getDetails().municipality;
 }
 
 bool Info::isActive() const {
@@ -3,14 +3,21 @@
 
 
 #include <cstdint>
+#include <deque>
 #include <string>
 #include <variant>
 #include <optional>
+#include "StringPool.h"
+
+class NodeCode;
 
 /**
  * @brief Information inside a Vertex.
  * @details This class is used to store information inside a Vertex.\n
- * A vertex can be a Reservoir, a Pump or a City. Depending on the kind of vertex, the data will be different.
+ * A vertex can be a Reservoir, a Pump or a City. Depending on the kind of vertex, the data will be different.\n
+ * Only the data used by the algorithms (kind, id, active flag and capacity / demand) is stored
+ * inside the object, which keeps it small and trivially copyable. The descriptive data (names and
+ * population) is kept in a side table, see Info::Details.
  */
 
 class Info {
@@ -19,7 +26,7 @@ public:
   /**
    * @brief Enum with the possible kinds of Vertex.
    */
-  enum Kind {
+  enum Kind : uint8_t {
     /// Water reservoir, capable of providing water
     Reservoir,
     /// Pumping station, connects reservoirs to cities
@@ -34,12 +41,13 @@ public:
   struct ReservoirData {
     /// Capacity
     uint32_t cap;
-    /// Name
-    std::string location;
-    /// Municipality where it is located
-    std::string municipality;
-    /// Constructor
-    ReservoirData(uint32_t c, std::string l, std::string m): cap(c), location(l), municipality(m) {};
+    /// Name (symbol in StringPool::global())
+    StringPool::Symbol location;
+    /// Municipality where it is located (symbol in StringPool::global())
+    StringPool::Symbol municipality;
+    /// Constructor, interns the names
+    ReservoirData(uint32_t c, std::string_view l, std::string_view m)
+        : cap(c), location(StringPool::global().intern(l)), municipality(StringPool::global().intern(m)) {};
   };
 
   /**
@@ -47,31 +55,52 @@ public:
    */
   struct CityData {
     /// Rate demand in m³/s
-    float cap;
-    /// City of the delivery site
-    std::string location;
+    double cap;
+    /// City of the delivery site (symbol in StringPool::global())
+    StringPool::Symbol location;
     /// Total population served
     uint32_t population;
-    /// Constructor
-    CityData(float c, std::string l, uint32_t p): cap(c), location(l), population(p) {};
+    /// Constructor, interns the name
+    CityData(double c, std::string_view l, uint32_t p)
+        : cap(c), location(StringPool::global().intern(l)), population(p) {};
   };
 
   /**
    * @brief Information inside a Pump Vertex.
-   * @details This struct is empty.
    */
   struct PumpData {
+    /// Maximum flow through the pumping station (nothing if unlimited)
+    std::optional<uint32_t> cap;
     /// Constructor
     PumpData() = default;
+    /// Constructor for a pumping station with a throughput limit
+    explicit PumpData(std::optional<uint32_t> c) : cap(c) {};
+  };
+
+  /**
+   * @brief Descriptive (cold) data of a Vertex.
+   * @details Not used by the algorithms, so it lives in a side table referenced by index
+   * instead of inside every Info.
+   */
+  struct Details {
+    /// Name of the reservoir / city (symbol in StringPool::global())
+    StringPool::Symbol location = StringPool::EMPTY;
+    /// Municipality where the reservoir is located (symbol in StringPool::global())
+    StringPool::Symbol municipality = StringPool::EMPTY;
+    /// Total population served by the city
+    uint32_t population = 0;
+    /// Demand of the city, when it is not a whole number (see Info::getCap())
+    double demand = 0;
   };
 
   /**
    * @brief Constructor
+   * @details The descriptive data inside the variant is moved to the side table.
    * @param kind: Kind of Vertex
    * @param id: Id number
    * @param data: Data for the Vertex. This variant can hold a ReservoirData, a PumpData or a CityData.
    */
-  Info(Kind kind, uint16_t id, const std::variant<ReservoirData, PumpData, CityData> &data);
+  Info(Kind kind, uint32_t id, const std::variant<ReservoirData, PumpData, CityData> &data);
 
   /**
    * @brief Getter for the kind of Vertex
@@ -83,32 +112,41 @@ public:
    * @brief Getter for the id number
    * @return Id number
    */
-  uint16_t getId() const;
+  uint32_t getId() const;
 
   /**
-   * @brief Getter for the data inside
-   * @warning It is more appropriate to use the other getters:\n
-   * - Info::getCap()\n
-   * - Info::getLocation()\n
-   * - Info::getPopulation()\n
-   * - Info::getMunicipality()
-   * @return A variant with the data
+   * @brief Getter for the packed code (kind and id) of the Vertex
+   * @return NodeCode
    */
-  const std::variant<ReservoirData, PumpData, CityData> &getData() const;
+  NodeCode getCode() const;
+
+  /**
+   * @brief Getter for the descriptive data in the side table
+   * @return A reference to the Details of this vertex (empty for pumps)
+   */
+  const Details &getDetails() const;
 
   /**
    * @brief Getter for the capacity / demand of the Vertex
-   * @details Only works if the kind of Vertex is a Reservoir or a City.
+   * @details Works if the kind of Vertex is a Reservoir, a City or a Pump with a throughput limit.
+   * The value is exact: whole numbers are kept as integers, and the demands with a fraction as a
+   * double in the side table.
    * @return Capacity in m³/s
    */
-  std::optional<float> getCap() const;
+  std::optional<double> getCap() const;
 
   /**
    * @brief Getter for the name / city of the Vertex
    * @details Only works if the kind of Vertex is a Reservoir or a City.
-   * @return String with the name
+   * @return String with the name (empty for pumps)
    */
-  std::optional<std::string> getLocation() const;
+  std::string_view getLocation() const;
+
+  /**
+   * @brief Getter for the interned name / city of the Vertex
+   * @return Symbol of the name in StringPool::global() (StringPool::EMPTY for pumps)
+   */
+  StringPool::Symbol getLocationId() const;
 
   /**
    * @brief Getter for the population served by the city
@@ -120,9 +158,15 @@ public:
   /**
    * @brief Getter for the municipality of the reservoir
    * @details Only works if the kind of Vertex is a Reservoir.
-   * @return String with the municipality
+   * @return String with the municipality (empty for other kinds)
+   */
+  std::string_view getMunicipality() const;
+
+  /**
+   * @brief Getter for the interned municipality of the reservoir
+   * @return Symbol of the municipality in StringPool::global() (StringPool::EMPTY for other kinds)
    */
-  std::optional<std::string> getMunicipality() const;
+  StringPool::Symbol getMunicipalityId() const;
 
   /// Get active status
   bool isActive() const;
@@ -139,12 +183,32 @@ public:
   bool operator==(const Info &rhs) const;
 
 private:
+  /// Value of Info::details when the vertex has no descriptive data
+  static constexpr uint32_t NO_DETAILS = UINT32_MAX;
+
+  /// Where the capacity / demand of the vertex is kept
+  enum class CapStorage : uint8_t {
+    /// In Info::cap
+    Whole,
+    /// In the Details::demand of the side table (a demand that is not a whole number)
+    Fraction,
+    /// Nowhere: a pump without throughput limit
+    Unlimited
+  };
+
+  /// Side table with the Details of every vertex (a deque keeps the references stable)
+  static std::deque<Details> &detailsTable();
+
+  /// Capacity / demand / throughput limit, when it is a whole number (see Info::storage)
+  uint32_t cap;
+  /// Index of the descriptive data in the side table
+  uint32_t details;
+  /// Id number
+  uint32_t id;
   /// Kind of Vertex (Reservoir, Pump or City)
   Kind kind;
-  /// Id number
-  uint16_t id;
-  /// Data for the Vertex (ReservoirData, PumpData or CityData)
-  std::variant<ReservoirData, PumpData, CityData> data;
+  /// Where the capacity / demand is kept
+  CapStorage storage;
   /// Is active boolean
   bool is_active;
 };
@@ -153,7 +217,7 @@ private:
 namespace std {
     template<> struct hash<Info> {
         size_t operator()(const Info& info) const noexcept {
-            return hash<uint16_t>()(info.getId()) ^ (hash<int>()(info.getKind()) << 1);
+            return hash<uint32_t>()(info.getId()) ^ (hash<int>()(info.getKind()) << 1);
         }
     };
 }
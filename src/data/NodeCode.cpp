@@ -0,0 +1,52 @@
+#include "NodeCode.h"
+#include <charconv>
+
+std::optional<NodeCode> NodeCode::parse(std::string_view code) {
+  Info::Kind kind;
+  if (code.starts_with("C_")) {
+    kind = Info::Kind::City;
+    code.remove_prefix(2);
+  } else if (code.starts_with("R_")) {
+    kind = Info::Kind::Reservoir;
+    code.remove_prefix(2);
+  } else if (code.starts_with("PS_")) {
+    kind = Info::Kind::Pump;
+    code.remove_prefix(3);
+  } else {
+    return {};
+  }
+  uint32_t id;
+  auto [end, ec] = std::from_chars(code.data(), code.data() + code.size(), id);
+  if (ec != std::errc() || end != code.data() + code.size() || id > MAX_ID)
+    return {};
+  return NodeCode(kind, id);
+}
+
+size_t NodeCode::format(char *out) const {
+  char *p = out;
+  switch (getKind()) {
+  case Info::Kind::City:
+    *p++ = 'C';
+    break;
+  case Info::Kind::Reservoir:
+    *p++ = 'R';
+    break;
+  case Info::Kind::Pump:
+    *p++ = 'P';
+    *p++ = 'S';
+    break;
+  }
+  *p++ = '_';
+  p = std::to_chars(p, out + MAX_LENGTH, getId()).ptr;
+  return p - out;
+}
+
+std::string NodeCode::toString() const {
+  char buffer[MAX_LENGTH];
+  return {buffer, format(buffer)};
+}
+
+std::ostream &operator<<(std::ostream &os, NodeCode code) {
+  char buffer[NodeCode::MAX_LENGTH];
+  return os << std::string_view(buffer, code.format(buffer));
+}
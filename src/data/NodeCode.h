@@ -0,0 +1,87 @@
+#ifndef DA2324_PRJ1_G163_NODECODE_H
+#define DA2324_PRJ1_G163_NODECODE_H
+
+#include "Info.h"
+#include <compare>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Code of a vertex ("C_12", "PS_71", "R_3") packed in 32 bits.
+ * @details The two most significant bits hold the Info::Kind and the remaining
+ * 30 bits hold the id number, so ids up to NodeCode::MAX_ID (over a billion)
+ * can be represented. Codes are hashed, compared and ordered as plain
+ * integers (by kind, then by id); they are only turned into strings when they
+ * are printed.
+ */
+class NodeCode {
+public:
+  /// Number of bits used by the id number
+  static constexpr uint32_t ID_BITS = 30;
+  /// Largest id number that can be packed
+  static constexpr uint32_t MAX_ID = (1u << ID_BITS) - 1;
+  /// Maximum length of a formatted code ("PS_" and 10 digits)
+  static constexpr size_t MAX_LENGTH = 13;
+
+  /// Default constructor (the code "R_0")
+  constexpr NodeCode() : packed(0) {}
+
+  /**
+   * @brief Constructor
+   * @param kind: Info::Kind of the vertex
+   * @param id: Id number, at most NodeCode::MAX_ID
+   */
+  constexpr NodeCode(Info::Kind kind, uint32_t id)
+      : packed((static_cast<uint32_t>(kind) << ID_BITS) | (id & MAX_ID)) {}
+
+  /// Getter for the kind of vertex
+  constexpr Info::Kind getKind() const { return static_cast<Info::Kind>(packed >> ID_BITS); }
+
+  /// Getter for the id number
+  constexpr uint32_t getId() const { return packed & MAX_ID; }
+
+  /// The packed representation
+  constexpr uint32_t raw() const { return packed; }
+
+  /// Comparison (by kind, then by id)
+  constexpr auto operator<=>(const NodeCode &) const = default;
+
+  /**
+   * @brief Parses a code.
+   * @param code: A string with the format "x_y" where x is the kind of Vertex ('C', 'R' or 'PS') and y is the id number.
+   * @return The code, or nothing if the string is not a valid code.
+   */
+  static std::optional<NodeCode> parse(std::string_view code);
+
+  /**
+   * @brief Writes the code into a buffer, without allocating.
+   * @param out: Buffer with at least NodeCode::MAX_LENGTH characters.
+   * @return Number of characters written.
+   */
+  size_t format(char *out) const;
+
+  /// The code as a string ("C_12", "PS_71", "R_3")
+  std::string toString() const;
+
+private:
+  /// Kind (2 most significant bits) and id number (30 least significant bits)
+  uint32_t packed;
+};
+
+/// Prints the code without building a string
+std::ostream &operator<<(std::ostream &os, NodeCode code);
+
+/// Hash function for NodeCode
+namespace std {
+    template<> struct hash<NodeCode> {
+        size_t operator()(const NodeCode& code) const noexcept {
+            return hash<uint32_t>()(code.raw());
+        }
+    };
+}
+
+#endif // DA2324_PRJ1_G163_NODECODE_H
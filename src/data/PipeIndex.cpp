@@ -0,0 +1,32 @@
+#include "PipeIndex.h"
+
+void PipeIndex::insert(NodeCode orig, NodeCode dest, uint32_t id, bool undirected) {
+  auto [k, direction] = key(orig, dest);
+  Entry &entry = entries[k];
+  entry.ids[direction] = id;
+  if (undirected)
+    entry.ids[1 - direction] = id;
+}
+
+uint32_t PipeIndex::erase(NodeCode orig, NodeCode dest) {
+  auto [k, direction] = key(orig, dest);
+  auto it = entries.find(k);
+  if (it == entries.end())
+    return NONE;
+  Entry &entry = it->second;
+  uint32_t id = entry.ids[direction];
+  if (id == NONE)
+    return NONE;
+  entry.ids[direction] = NONE;
+  if (entry.ids[1 - direction] == id) // bidirectional pipe
+    entry.ids[1 - direction] = NONE;
+  if (entry.ids[0] == NONE && entry.ids[1] == NONE)
+    entries.erase(it);
+  return id;
+}
+
+uint32_t PipeIndex::find(NodeCode orig, NodeCode dest) const {
+  auto [k, direction] = key(orig, dest);
+  auto it = entries.find(k);
+  return it == entries.end() ? NONE : it->second.ids[direction];
+}
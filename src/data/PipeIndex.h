@@ -0,0 +1,80 @@
+#ifndef DA2324_PRJ1_G163_PIPEINDEX_H
+#define DA2324_PRJ1_G163_PIPEINDEX_H
+
+#include "NodeCode.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * @brief Index of the pipes by their service points.
+ * @details Every pipe has a stable id (its link in the flow network). The index
+ * is keyed by the unordered pair of service points, so a pipe and the pipe in
+ * the opposite direction share one entry, and looking up a pipe by its codes
+ * costs one hash probe instead of a scan of the adjacency of the origin.\n
+ * A bidirectional pipe can be found from either of its service points.
+ */
+class PipeIndex {
+public:
+  /// Marks a missing pipe
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  /**
+   * @brief Adds a pipe to the index (replacing any pipe with the same direction).
+   * @note Time complexity: O(1) on average.
+   * @param orig: Code of the origin of the pipe
+   * @param dest: Code of the destination of the pipe
+   * @param id: Id of the pipe
+   * @param undirected: If true, the pipe is also found from dest to orig.
+   */
+  void insert(NodeCode orig, NodeCode dest, uint32_t id, bool undirected);
+
+  /**
+   * @brief Removes the pipe that carries water from orig to dest.
+   * @details A bidirectional pipe is removed in both directions.
+   * @note Time complexity: O(1) on average.
+   * @return The id of the removed pipe, or PipeIndex::NONE if there was none.
+   */
+  uint32_t erase(NodeCode orig, NodeCode dest);
+
+  /**
+   * @brief Finds the pipe that carries water from orig to dest.
+   * @details That is, the unidirectional pipe from orig to dest or the bidirectional pipe between them.
+   * @note Time complexity: O(1) on average.
+   * @return The id of the pipe, or PipeIndex::NONE if there is none.
+   */
+  uint32_t find(NodeCode orig, NodeCode dest) const;
+
+  /// Reserves room for n pipes
+  void reserve(size_t n) { entries.reserve(n); }
+  /// Removes every pipe
+  void clear() { entries.clear(); }
+  /// Number of pairs of service points connected by at least one pipe
+  size_t size() const { return entries.size(); }
+
+private:
+  /// Pipes between two service points: [0] from the smaller code to the larger, [1] the opposite
+  struct Entry {
+    uint32_t ids[2] = {NONE, NONE};
+  };
+
+  /// Hash of an ordered pair of codes
+  struct KeyHash {
+    size_t operator()(const std::pair<NodeCode, NodeCode> &key) const {
+      return std::hash<uint64_t>()(static_cast<uint64_t>(key.first.raw()) << 32 | key.second.raw());
+    }
+  };
+
+  /// Pipes by (smaller code, larger code)
+  std::unordered_map<std::pair<NodeCode, NodeCode>, Entry, KeyHash> entries;
+
+  /// Key of the pair and the direction of orig -> dest in its Entry
+  static std::pair<std::pair<NodeCode, NodeCode>, int> key(NodeCode orig, NodeCode dest) {
+    if (dest < orig)
+      return {{dest, orig}, 1};
+    return {{orig, dest}, 0};
+  }
+};
+
+#endif // DA2324_PRJ1_G163_PIPEINDEX_H
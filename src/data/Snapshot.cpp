@@ -0,0 +1,172 @@
+#include "Snapshot.h"
+#include "../Utils.h"
+#include "Data.h"
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+#include "StringPool.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static constexpr char MAGIC[8] = {'D', 'A', 'W', 'S', 'N', 'A', 'P', '\0'};
+
+/// Rounds an offset up to the next multiple of 8, so that every table is aligned.
+static uint64_t align8(uint64_t offset) { return (offset + 7) & ~uint64_t(7); }
+
+Snapshot::Snapshot(const std::string &path) {
+#ifndef _WIN32
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    panic("Could not open the snapshot " + path);
+  struct stat st {};
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    panic("Could not read the snapshot " + path);
+  }
+  size = st.st_size;
+  if (size >= sizeof(Header)) {
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+      close(fd);
+      panic("Could not map the snapshot " + path);
+    }
+    base = static_cast<const std::byte *>(mapped);
+  }
+  close(fd);
+#else
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    panic("Could not open the snapshot " + path);
+  file.seekg(0, std::ios::end);
+  size = file.tellg();
+  file.seekg(0, std::ios::beg);
+  buffer.resize(size);
+  file.read(reinterpret_cast<char *>(buffer.data()), size);
+  base = buffer.data();
+#endif
+
+  if (size < sizeof(Header) || std::memcmp(header().magic, MAGIC, sizeof(MAGIC)) != 0)
+    panic(path + " is not a snapshot file");
+  const Header &h = header();
+  if (h.version != VERSION)
+    panic("The snapshot " + path + " has version " + std::to_string(h.version) +
+          ", but version " + std::to_string(VERSION) + " was expected. Regenerate it from the csv files.");
+  // the counts come from the file, so they are compared with the bytes left instead of multiplied (which can overflow)
+  auto fits = [this](uint64_t offset, uint64_t count, uint64_t recordSize) {
+    return offset <= size && count <= (size - offset) / recordSize;
+  };
+  bool valid = fits(h.vertexOffset, h.vertexCount, sizeof(VertexRecord)) &&
+               fits(h.edgeOffset, h.edgeCount, sizeof(EdgeRecord)) &&
+               fits(h.stringOffset, h.stringCount, sizeof(uint32_t)) &&
+               h.stringBytes <= size - h.stringOffset - h.stringCount * sizeof(uint32_t);
+  if (!valid)
+    panic("The snapshot " + path + " is truncated");
+}
+
+Snapshot::~Snapshot() {
+#ifndef _WIN32
+  if (base != nullptr)
+    munmap(const_cast<std::byte *>(base), size);
+#endif
+}
+
+const Snapshot::Header &Snapshot::header() const {
+  return *reinterpret_cast<const Header *>(base);
+}
+
+const Snapshot::VertexRecord *Snapshot::vertices() const {
+  return reinterpret_cast<const VertexRecord *>(base + header().vertexOffset);
+}
+
+const Snapshot::EdgeRecord *Snapshot::edges() const {
+  return reinterpret_cast<const EdgeRecord *>(base + header().edgeOffset);
+}
+
+std::string_view Snapshot::string(uint32_t symbol) const {
+  const Header &h = header();
+  if (symbol >= h.stringCount)
+    return {};
+  const auto *offsets = reinterpret_cast<const uint32_t *>(base + h.stringOffset);
+  const auto *chars = reinterpret_cast<const char *>(offsets + h.stringCount);
+  // a string ends at its null character, which must come before the next string
+  uint64_t begin = offsets[symbol];
+  uint64_t end = symbol + 1 < h.stringCount ? offsets[symbol + 1] : h.stringBytes;
+  if (begin >= end || end > h.stringBytes)
+    return {};
+  const auto *nul = static_cast<const char *>(std::memchr(chars + begin, '\0', end - begin));
+  return {chars + begin, nul != nullptr ? static_cast<size_t>(nul - (chars + begin)) : end - begin};
+}
+
+bool Snapshot::isSnapshot(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  char magic[sizeof(MAGIC)] = {};
+  file.read(magic, sizeof(magic));
+  return file && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+bool Snapshot::write(const std::string &path, Data &data) {
+  std::vector<Vertex<Info> *> vertexSet = data.getGraph().getVertexSet();
+
+  // The symbols of the global pool are stored as they are
+  const StringPool &strings = StringPool::global();
+  std::vector<uint32_t> stringOffsets;
+  std::string pool;
+  for (StringPool::Symbol symbol = 0; symbol < strings.size(); ++symbol) {
+    stringOffsets.push_back(pool.size());
+    pool += strings.view(symbol);
+    pool.push_back('\0');
+  }
+
+  // NaN marks the pipes and stations without a failure probability
+  const float noFailure = std::numeric_limits<float>::quiet_NaN();
+  std::unordered_map<Vertex<Info> *, uint32_t> index;
+  std::vector<VertexRecord> vertices;
+  vertices.reserve(vertexSet.size());
+  for (Vertex<Info> *v : vertexSet) {
+    const Info &info = v->getInfo();
+    index[v] = vertices.size();
+    vertices.push_back({static_cast<uint32_t>(info.getKind()), info.getId(),
+                        info.getCap().value_or(std::numeric_limits<double>::infinity()), info.getPopulation().value_or(0),
+                        info.getLocationId(), info.getMunicipalityId(), data.getFailure(v).value_or(noFailure)});
+  }
+
+  std::vector<EdgeRecord> edges;
+  for (Vertex<Info> *v : vertexSet) {
+    for (Edge<Info> *e : v->getAdj()) {
+      edges.push_back({index[v], index[e->getDest()], e->getWeight(), e->isUndirected(),
+                       data.getFailure(e).value_or(noFailure), data.getCost(e)});
+    }
+  }
+
+  Header h{};
+  std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+  h.version = VERSION;
+  h.vertexCount = vertices.size();
+  h.edgeCount = edges.size();
+  h.stringCount = stringOffsets.size();
+  h.stringBytes = pool.size();
+  h.vertexOffset = align8(sizeof(Header));
+  h.edgeOffset = align8(h.vertexOffset + vertices.size() * sizeof(VertexRecord));
+  h.stringOffset = align8(h.edgeOffset + edges.size() * sizeof(EdgeRecord));
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file)
+    return false;
+  auto writeAt = [&file](uint64_t offset, const void *bytes, size_t n) {
+    static const char zeros[8] = {};
+    file.write(zeros, offset - file.tellp()); // padding
+    file.write(static_cast<const char *>(bytes), n);
+  };
+  writeAt(0, &h, sizeof(h));
+  writeAt(h.vertexOffset, vertices.data(), vertices.size() * sizeof(VertexRecord));
+  writeAt(h.edgeOffset, edges.data(), edges.size() * sizeof(EdgeRecord));
+  writeAt(h.stringOffset, stringOffsets.data(), stringOffsets.size() * sizeof(uint32_t));
+  file.write(pool.data(), pool.size());
+  return file.good();
+}
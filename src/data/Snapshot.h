@@ -0,0 +1,126 @@
+#ifndef DA2324_PRJ1_G163_SNAPSHOT_H
+#define DA2324_PRJ1_G163_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Data;
+
+/**
+ * @brief Compiled binary image of a loaded network.
+ * @details A snapshot is written once from a loaded Data object and can then be
+ * used instead of the four csv files. The file is mapped into memory with
+ * `mmap` and its tables are used in place, so loading it only rebuilds the graph
+ * from flat arrays (no parsing and no vertex lookups).\n
+ * Layout of the file (all values in the native byte order):
+ * - Header (magic, format version, counts and offsets of each table);
+ * - Vertex table (one Snapshot::VertexRecord per vertex);
+ * - Edge table (one Snapshot::EdgeRecord per pipe, bidirectional pipes included);
+ * - String pool (the StringPool symbols in order: an offset per symbol followed
+ *   by the null-terminated strings).
+ */
+class Snapshot {
+public:
+  /// Bumped every time the layout of the file changes.
+  static constexpr uint32_t VERSION = 8;
+
+  /// Fixed size header at the beginning of the file.
+  struct Header {
+    /// Identifies the file as a snapshot ("DAWSNAP\0")
+    char magic[8];
+    /// Format version, must match Snapshot::VERSION
+    uint32_t version;
+    /// Number of records in the vertex table
+    uint64_t vertexCount;
+    /// Number of records in the edge table
+    uint64_t edgeCount;
+    /// Number of strings in the string pool
+    uint64_t stringCount;
+    /// Size in bytes of the characters of the string pool
+    uint64_t stringBytes;
+    /// Offsets (in bytes, from the beginning of the file) of each table
+    uint64_t vertexOffset, edgeOffset, stringOffset;
+  };
+
+  /// Entry of the vertex table.
+  struct VertexRecord {
+    /// Info::Kind of the vertex
+    uint32_t kind;
+    /// Id number
+    uint32_t id;
+    /// Capacity / demand / throughput limit, exact (infinity for pumps without limit)
+    double cap;
+    /// Population served (only for cities)
+    uint32_t population;
+    /// Symbol of the location in the string pool
+    uint32_t location;
+    /// Symbol of the municipality in the string pool
+    uint32_t municipality;
+    /// Failure probability (only for pumps, NaN if it has none)
+    float failure;
+  };
+
+  /// Entry of the edge table.
+  struct EdgeRecord {
+    /// Index of the source vertex in the vertex table
+    uint32_t orig;
+    /// Index of the destination vertex in the vertex table
+    uint32_t dest;
+    /// Capacity of the pipe
+    double capacity;
+    /// 1 if the pipe can be used in both directions (Edge::isUndirected), 0 otherwise
+    uint32_t undirected;
+    /// Failure probability of the pipe (NaN if it has none)
+    float failure;
+    /// Pumping cost per unit of water (0 if it has none)
+    float cost;
+  };
+
+  /**
+   * @brief Maps a snapshot file into memory and validates its header.
+   * @details Calls panic() if the file cannot be read or is not a valid snapshot.
+   * @param path: Path to the snapshot file.
+   */
+  explicit Snapshot(const std::string &path);
+  ~Snapshot();
+  Snapshot(const Snapshot &) = delete;
+  Snapshot &operator=(const Snapshot &) = delete;
+
+  /// Getter for the header
+  const Header &header() const;
+  /// Pointer to the first record of the vertex table
+  const VertexRecord *vertices() const;
+  /// Pointer to the first record of the edge table
+  const EdgeRecord *edges() const;
+  /// String of a symbol of the string pool
+  std::string_view string(uint32_t symbol) const;
+
+  /**
+   * @brief Writes a snapshot of a loaded network.
+   * @note Time complexity: O(V + E) where V is the number of vertexes and E is
+   * the number of edges in the graph.
+   * @param path: Path of the file to write.
+   * @param data: The loaded network.
+   * @return true if the file was written successfully, false otherwise.
+   */
+  static bool write(const std::string &path, Data &data);
+
+  /**
+   * @brief Checks if a file starts with the snapshot magic number.
+   * @param path: Path to the file.
+   */
+  static bool isSnapshot(const std::string &path);
+
+private:
+  /// Beginning of the mapped file
+  const std::byte *base = nullptr;
+  /// Size of the mapped file
+  size_t size = 0;
+  /// Fallback storage when memory mapping is not available
+  std::vector<std::byte> buffer;
+};
+
+#endif // DA2324_PRJ1_G163_SNAPSHOT_H
@@ -0,0 +1,26 @@
+#include "StringPool.h"
+
+StringPool::StringPool() { intern(""); }
+
+StringPool &StringPool::global() {
+  static StringPool pool;
+  return pool;
+}
+
+StringPool::Symbol StringPool::intern(std::string_view s) {
+  auto it = symbols.find(s);
+  if (it != symbols.end())
+    return it->second;
+  Symbol symbol = strings.size();
+  const std::string &stored = strings.emplace_back(s);
+  symbols.emplace(stored, symbol);
+  return symbol;
+}
+
+std::string_view StringPool::view(Symbol symbol) const {
+  return strings[symbol];
+}
+
+uint32_t StringPool::size() const {
+  return strings.size();
+}
@@ -0,0 +1,57 @@
+#ifndef DA2324_PRJ1_G163_STRINGPOOL_H
+#define DA2324_PRJ1_G163_STRINGPOOL_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * @brief Pool of interned strings.
+ * @details Every distinct string is stored once and identified by a 32-bit
+ * symbol, so equal names share their memory and comparing two names is an
+ * integer comparison. Symbols and the views returned by StringPool::view() stay
+ * valid for the lifetime of the pool.\n
+ * The names of the network (locations and municipalities) are interned in the
+ * global pool, StringPool::global(), while the data is loaded.
+ */
+class StringPool {
+public:
+  /// Identifier of an interned string
+  using Symbol = uint32_t;
+  /// Symbol of the empty string, always present
+  static constexpr Symbol EMPTY = 0;
+
+  /// Constructor
+  StringPool();
+
+  /**
+   * @brief The pool shared by every Info.
+   */
+  static StringPool &global();
+
+  /**
+   * @brief Interns a string.
+   * @note Time complexity: O(L) where L is the length of the string.
+   * @return The symbol of the string; the same string always gets the same symbol.
+   */
+  Symbol intern(std::string_view s);
+
+  /**
+   * @brief The string of a symbol.
+   * @note Time complexity: O(1).
+   */
+  std::string_view view(Symbol symbol) const;
+
+  /// Number of distinct strings in the pool (including the empty string)
+  uint32_t size() const;
+
+private:
+  /// Storage of the strings, indexed by symbol (a deque keeps them in place)
+  std::deque<std::string> strings;
+  /// Symbol of each interned string
+  std::unordered_map<std::string_view, Symbol> symbols;
+};
+
+#endif // DA2324_PRJ1_G163_STRINGPOOL_H
@@ -0,0 +1,412 @@
+#ifndef DA2324_PRJ1_G163_BOYKOVKOLMOGOROV_H
+#define DA2324_PRJ1_G163_BOYKOVKOLMOGOROV_H
+
+#include "FlowNetwork.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * @brief Boykov-Kolmogorov max-flow engine over a FlowNetwork, with search trees kept between solves.
+ * @details Grows a search tree from the super source and another from the super sink
+ * in the residual network. When they touch, the path through both trees is augmented,
+ * and the vertexes cut from their tree by saturated links (orphans) are adopted by
+ * another parent of the same tree or freed.\n
+ * The trees stay valid after a solve, so a scenario that differs in one pipe or one
+ * site is solved incrementally: setCapacity() and setActive() cancel the flow that
+ * became infeasible (back to the super source and forward to the super sink), orphan
+ * only the vertexes whose tree link was affected and resume() repairs and regrows from
+ * there. save() and restore() keep a solved state, so every scenario of a sweep starts
+ * from the same baseline.
+ */
+template <class F>
+class BoykovKolmogorov {
+public:
+  /**
+   * @brief Increases the flow of the network until it is maximum, building the trees from scratch.
+   * @details Starts from the current flow of the network (clear it first to solve from scratch).
+   * @note Time complexity: O(V^2 * L * |C|) in the worst case, where V is the number of vertexes,
+   * L is the number of links and |C| is the value of the minimum cut; much faster on sparse networks.
+   * @return The flow added to the network.
+   */
+  F solve(FlowNetwork<F> &network) {
+    uint32_t n = network.getNumVertex();
+    s = network.getSource();
+    t = network.getSink();
+    tree.assign(n, FREE);
+    parentLink.assign(n, FlowNetwork<F>::NONE);
+    parentVertex.assign(n, FlowNetwork<F>::NONE);
+    timestamp.assign(n, 0);
+    dist.assign(n, 0);
+    queued.assign(n, 0);
+    imbalance.assign(n, 0);
+    unbalanced.clear();
+    queue.clear();
+    head = 0;
+    orphans.clear();
+    time = 0;
+    tree[s] = SOURCE;
+    tree[t] = SINK;
+    activate(s);
+    activate(t);
+    return resume(network);
+  }
+
+  /**
+   * @brief Increases the flow of the network until it is maximum, reusing the trees of the last solve.
+   * @details Only valid after solve() or restore(), with every change made through setCapacity() and setActive().
+   * @return The flow added to the network.
+   */
+  F resume(FlowNetwork<F> &network) {
+    F total = 0;
+    adopt(network);
+    uint32_t sv, tv, l;
+    while (grow(network, sv, tv, l)) {
+      total += augment(network, sv, tv, l);
+      adopt(network);
+    }
+    return total;
+  }
+
+  /**
+   * @brief Changes the capacity of a link, keeping the flow feasible and the trees valid.
+   * @details If the flow no longer fits, the extra flow is cancelled along the paths that carry it.
+   * Call resume() afterwards to make the flow maximum again.
+   */
+  void setCapacity(FlowNetwork<F> &network, uint32_t l, F capacity) {
+    network.setCapacity(l, capacity);
+    F flow = network.getFlow(l);
+    if (flow > network.getCapacity(l))
+      cancel(network, l, flow - network.getCapacity(l));
+    else if (flow < network.getLower(l))
+      cancel(network, l, flow - network.getLower(l));
+    touch(network, l);
+    repair(network);
+  }
+
+  /**
+   * @brief Enables or disables a vertex, keeping the flow feasible and the trees valid.
+   * @details Disabling a vertex cancels all the flow through it. Call resume() afterwards to make the
+   * flow maximum again.
+   */
+  void setActive(FlowNetwork<F> &network, uint32_t v, bool active) {
+    if (network.isActive(v) == active)
+      return;
+    network.setActive(v, active);
+    if (active) {
+      // the neighbours may now grow into v
+      for (uint32_t a = network.arcBegin(v); a < network.arcEnd(v); a++)
+        if (tree[network.arcHead(a)] != FREE)
+          activate(network.arcHead(a));
+      return;
+    }
+    for (uint32_t a = network.arcBegin(v); a < network.arcEnd(v); a++) {
+      uint32_t l = network.arcLink(a);
+      if (network.getFlow(l) != 0)
+        cancel(network, l, network.getFlow(l));
+      touch(network, l);
+    }
+    for (uint32_t a = network.arcBegin(v); a < network.arcEnd(v); a++)
+      if (parentVertex[network.arcHead(a)] == v)
+        makeOrphan(network.arcHead(a));
+    tree[v] = FREE;
+    parentLink[v] = parentVertex[v] = FlowNetwork<F>::NONE;
+    repair(network);
+  }
+
+  /// Keeps the flow of the network and the trees (after solve() or resume())
+  void save(const FlowNetwork<F> &network) {
+    savedFlow.assign(network.flowData(), network.flowData() + network.getNumLinks());
+    savedTree = tree;
+    savedParentLink = parentLink;
+    savedParentVertex = parentVertex;
+    savedTimestamp = timestamp;
+    savedDist = dist;
+    savedTime = time;
+  }
+
+  /**
+   * @brief Goes back to the state kept by save().
+   * @details The capacities and the active vertexes of the network must be the ones of that moment.
+   * The arrays are copied in place, so no memory is allocated.
+   */
+  void restore(FlowNetwork<F> &network) {
+    std::copy(savedFlow.begin(), savedFlow.end(), network.flowData());
+    std::copy(savedTree.begin(), savedTree.end(), tree.begin());
+    std::copy(savedParentLink.begin(), savedParentLink.end(), parentLink.begin());
+    std::copy(savedParentVertex.begin(), savedParentVertex.end(), parentVertex.begin());
+    std::copy(savedTimestamp.begin(), savedTimestamp.end(), timestamp.begin());
+    std::copy(savedDist.begin(), savedDist.end(), dist.begin());
+    time = savedTime;
+    std::fill(queued.begin(), queued.end(), 0);
+    queue.clear();
+    head = 0;
+    orphans.clear();
+  }
+
+private:
+  /// Tree of a vertex
+  enum Tree : uint8_t { FREE, SOURCE, SINK };
+
+  uint32_t s = FlowNetwork<F>::NONE, t = FlowNetwork<F>::NONE;
+  /// Tree of each vertex
+  std::vector<uint8_t> tree;
+  /// Link to the parent of each vertex in its tree (NONE for the roots, free vertexes and orphans)
+  std::vector<uint32_t> parentLink;
+  /// Parent of each vertex in its tree
+  std::vector<uint32_t> parentVertex;
+  /// Adoption heuristic: when the distance to the root was last checked, and that distance
+  std::vector<uint32_t> timestamp, dist;
+  uint32_t time = 0;
+  /// Active vertexes (can still grow their tree), in FIFO order
+  std::vector<uint32_t> queue;
+  size_t head = 0;
+  std::vector<uint8_t> queued;
+  /// Vertexes that lost their parent
+  std::vector<uint32_t> orphans;
+  /// Flow to cancel at each vertex: > 0 for extra inflow, < 0 for extra outflow
+  std::vector<F> imbalance;
+  /// Vertexes with imbalance
+  std::vector<uint32_t> unbalanced;
+  // state kept by save()
+  std::vector<F> savedFlow;
+  std::vector<uint8_t> savedTree;
+  std::vector<uint32_t> savedParentLink, savedParentVertex, savedTimestamp, savedDist;
+  uint32_t savedTime = 0;
+
+  void activate(uint32_t v) {
+    if (queued[v])
+      return;
+    queued[v] = 1;
+    if (head == queue.size()) {
+      queue.clear();
+      head = 0;
+    } else if (head >= 4096 && 2 * head >= queue.size()) {
+      queue.erase(queue.begin(), queue.begin() + head);
+      head = 0;
+    }
+    queue.push_back(v);
+  }
+
+  void makeOrphan(uint32_t v) {
+    parentLink[v] = parentVertex[v] = FlowNetwork<F>::NONE;
+    orphans.push_back(v);
+  }
+
+  /// Residual capacity of the tree link of a vertex, in the direction of its tree
+  F treeResidual(const FlowNetwork<F> &network, uint32_t v) const {
+    uint32_t l = parentLink[v];
+    return tree[v] == SOURCE ? network.residualFrom(l, parentVertex[v]) : network.residualFrom(l, v);
+  }
+
+  /// The flow of a link changed: its ends may grow again, and a tree link may be saturated
+  void touch(const FlowNetwork<F> &network, uint32_t l) {
+    for (uint32_t v : {network.getOrig(l), network.getDest(l)}) {
+      if (tree[v] == FREE)
+        continue;
+      activate(v);
+      if (parentLink[v] == l && treeResidual(network, v) <= 0)
+        makeOrphan(v);
+    }
+  }
+
+  /// Adds unbalanced flow to a vertex (> 0 for extra inflow, < 0 for extra outflow)
+  void unbalance(uint32_t v, F amount) {
+    if (imbalance[v] == 0)
+      unbalanced.push_back(v);
+    imbalance[v] += amount;
+  }
+
+  /**
+   * @brief Removes `amount` of flow from a link (signed, in the direction of the link).
+   * @details The origin is left with extra inflow and the destination with extra outflow (the opposite
+   * for a negative amount); repair() cancels them.
+   */
+  void cancel(FlowNetwork<F> &network, uint32_t l, F amount) {
+    network.setFlow(l, network.getFlow(l) - amount);
+    unbalance(network.getOrig(l), amount);
+    unbalance(network.getDest(l), -amount);
+  }
+
+  /**
+   * @brief Cancels the unbalanced flow of the vertexes.
+   * @details Extra inflow is sent back along the links that carry flow into the vertex, until the
+   * super source; extra outflow is removed from the links that carry flow out of it, until the
+   * super sink. Only links with flow are changed, so the flow stays feasible.
+   */
+  void repair(FlowNetwork<F> &network) {
+    while (!unbalanced.empty()) {
+      uint32_t v = unbalanced.back();
+      unbalanced.pop_back();
+      F amount = imbalance[v];
+      imbalance[v] = 0;
+      if (amount == 0 || v == s || v == t)
+        continue;
+      for (uint32_t a = network.arcBegin(v); a < network.arcEnd(v) && amount != 0; a++) {
+        uint32_t l = network.arcLink(a);
+        uint32_t w = network.arcHead(a);
+        // flow from w into v (for extra inflow) or from v into w (for extra outflow)
+        F flow = network.isForward(a) ? -network.getFlow(l) : network.getFlow(l);
+        if (amount < 0)
+          flow = -flow;
+        if (flow <= 0)
+          continue;
+        F d = std::min(flow, amount > 0 ? amount : -amount);
+        if (amount > 0) {
+          network.pushFrom(l, v, d); // less flow from w to v
+          amount -= d;
+          unbalance(w, d);
+        } else {
+          network.pushFrom(l, w, d); // less flow from v to w
+          amount += d;
+          unbalance(w, -d);
+        }
+        touch(network, l);
+      }
+    }
+  }
+
+  /// Grows the trees until they touch: the path goes from sv (source tree) to tv (sink tree) through link l
+  bool grow(const FlowNetwork<F> &network, uint32_t &sv, uint32_t &tv, uint32_t &l) {
+    while (head < queue.size()) {
+      uint32_t p = queue[head];
+      if (tree[p] != FREE) {
+        for (uint32_t a = network.arcBegin(p); a < network.arcEnd(p); a++) {
+          uint32_t q = network.arcHead(a);
+          if (!network.isActive(q))
+            continue;
+          uint32_t link = network.arcLink(a);
+          F capacity = tree[p] == SOURCE ? network.residualFrom(link, p) : network.residualFrom(link, q);
+          if (capacity <= 0)
+            continue;
+          if (tree[q] == FREE) {
+            tree[q] = tree[p];
+            parentLink[q] = link;
+            parentVertex[q] = p;
+            timestamp[q] = timestamp[p];
+            dist[q] = dist[p] + 1;
+            activate(q);
+          } else if (tree[q] != tree[p]) {
+            // p stays active: it may have more paths
+            sv = tree[p] == SOURCE ? p : q;
+            tv = tree[p] == SOURCE ? q : p;
+            l = link;
+            return true;
+          }
+        }
+      }
+      queued[p] = 0;
+      head++;
+    }
+    return false;
+  }
+
+  F augment(FlowNetwork<F> &network, uint32_t sv, uint32_t tv, uint32_t l) {
+    F f = network.residualFrom(l, sv);
+    for (uint32_t v = sv; v != s; v = parentVertex[v])
+      f = std::min(f, network.residualFrom(parentLink[v], parentVertex[v]));
+    for (uint32_t v = tv; v != t; v = parentVertex[v])
+      f = std::min(f, network.residualFrom(parentLink[v], v));
+
+    network.pushFrom(l, sv, f);
+    for (uint32_t v = sv; v != s;) {
+      uint32_t parent = parentVertex[v];
+      network.pushFrom(parentLink[v], parent, f);
+      if (network.residualFrom(parentLink[v], parent) <= 0)
+        makeOrphan(v);
+      v = parent;
+    }
+    for (uint32_t v = tv; v != t;) {
+      uint32_t parent = parentVertex[v];
+      network.pushFrom(parentLink[v], v, f);
+      if (network.residualFrom(parentLink[v], v) <= 0)
+        makeOrphan(v);
+      v = parent;
+    }
+    return f;
+  }
+
+  /// Finds a new parent for every orphan, or frees it (and orphans its children)
+  void adopt(const FlowNetwork<F> &network) {
+    constexpr uint32_t FAR = std::numeric_limits<uint32_t>::max();
+    // the paths checked before the orphans were cut are no longer valid
+    if (!orphans.empty())
+      time++;
+    while (!orphans.empty()) {
+      uint32_t p = orphans.back();
+      orphans.pop_back();
+      if (tree[p] == FREE || parentVertex[p] != FlowNetwork<F>::NONE)
+        continue;
+      uint32_t root = tree[p] == SOURCE ? s : t;
+
+      // closest valid parent of the same tree (its path must reach the root)
+      uint32_t best = FlowNetwork<F>::NONE, bestLink = FlowNetwork<F>::NONE, bestDist = FAR;
+      for (uint32_t a = network.arcBegin(p); a < network.arcEnd(p); a++) {
+        uint32_t q = network.arcHead(a);
+        uint32_t link = network.arcLink(a);
+        if (tree[q] != tree[p] || !network.isActive(q))
+          continue;
+        F capacity = tree[p] == SOURCE ? network.residualFrom(link, q) : network.residualFrom(link, p);
+        if (capacity <= 0)
+          continue;
+        uint32_t d = 0, j = q;
+        bool valid;
+        while (true) {
+          if (timestamp[j] == time) {
+            d += dist[j];
+            valid = true;
+            break;
+          }
+          if (j == root) {
+            timestamp[j] = time;
+            dist[j] = 0;
+            valid = true;
+            break;
+          }
+          if (parentVertex[j] == FlowNetwork<F>::NONE) {
+            valid = false;
+            break;
+          }
+          d++;
+          j = parentVertex[j];
+        }
+        if (!valid)
+          continue;
+        if (d < bestDist) {
+          best = q;
+          bestLink = link;
+          bestDist = d;
+        }
+        for (j = q; timestamp[j] != time; j = parentVertex[j]) {
+          timestamp[j] = time;
+          dist[j] = d--;
+        }
+      }
+
+      if (best != FlowNetwork<F>::NONE) {
+        parentVertex[p] = best;
+        parentLink[p] = bestLink;
+        timestamp[p] = time;
+        dist[p] = bestDist + 1;
+        continue;
+      }
+
+      // no parent: p becomes free
+      for (uint32_t a = network.arcBegin(p); a < network.arcEnd(p); a++) {
+        uint32_t q = network.arcHead(a);
+        if (tree[q] != tree[p])
+          continue;
+        uint32_t link = network.arcLink(a);
+        F capacity = tree[p] == SOURCE ? network.residualFrom(link, q) : network.residualFrom(link, p);
+        if (capacity > 0)
+          activate(q);
+        if (parentVertex[q] == p)
+          makeOrphan(q);
+      }
+      tree[p] = FREE;
+    }
+  }
+};
+
+#endif // DA2324_PRJ1_G163_BOYKOVKOLMOGOROV_H
@@ -0,0 +1,256 @@
+#ifndef DA2324_PRJ1_G163_CONTRACTION_H
+#define DA2324_PRJ1_G163_CONTRACTION_H
+
+#include "FlowNetwork.h"
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Reduces a FlowNetwork to a smaller core with the same maximum flow.
+ * @details Vertexes other than the terminals only conserve flow, so many of them can be
+ * removed before solving:
+ * - *dead ends*: a vertex with a single link carries no flow, so it is removed with its link.
+ *   Repeated, this peels the trees that hang from the network without reaching a terminal;
+ * - *parallel links* between the same two vertexes are merged into one link, whose bounds are
+ *   the sums of their bounds;
+ * - *series links*: a vertex with two links (a chain of pumps, or a city fed by one pipe) is
+ *   removed and its links are replaced by one link, whose bounds are the intersection of their
+ *   bounds.
+ *
+ * The reductions are applied until none is left. Together they solve the trees of pipes that
+ * feed cities: every leaf city becomes a link to the super sink, the links of the siblings are
+ * merged, and their parent becomes a leaf in turn, which is the dynamic programming over the tree.
+ * Disabled vertexes and links without capacity are dropped first.\n
+ * The links of the core are *bounded links* (FlowNetwork::addBoundedLink()): a merge of an
+ * undirected and a directed pipe can carry more flow in one direction than in the other.
+ * Every reduction is recorded, so expand() maps a flow of the core back to every link of the
+ * original network: series links carry the flow of their combined link, and the flow of a merged
+ * link is given to its first link up to its bound, the rest to the second (both in the same
+ * direction, so no flow goes around in circles).\n
+ * The arrays are kept between calls, so a Contraction is meant to be reused.
+ */
+template <class F>
+class Contraction {
+public:
+  /**
+   * @brief Builds the core of a network with its current capacities and disabled vertexes.
+   * @note Time complexity: O(V + L) expected, where V is the number of vertexes and L is the number of links.
+   * @return The core, without flow.
+   */
+  FlowNetwork<F> &contract(const FlowNetwork<F> &network) {
+    uint32_t n = network.getNumVertex();
+    source = network.getSource();
+    sink = network.getSink();
+    original = network.getNumLinks();
+    links.clear();
+    alive.clear();
+    steps.clear();
+    between.clear();
+    worklist.clear();
+    degree.assign(n, 0);
+    removed.assign(n, 0);
+    adjacency.resize(n);
+    for (uint32_t v = 0; v < n; v++) {
+      adjacency[v].clear();
+      removed[v] = !network.isActive(v);
+    }
+
+    // no link carries more than the capacity of the super source, which keeps the merged bounds in range
+    bound = 0;
+    for (uint32_t a = network.arcBegin(source); a < network.arcEnd(source); a++)
+      bound += network.getCapacity(network.arcLink(a));
+    for (uint32_t l = 0; l < original; l++)
+      links.push_back({network.getOrig(l), network.getDest(l), network.getLower(l), network.getCapacity(l)});
+    alive.assign(original, 0);
+    for (uint32_t l = 0; l < original; l++) {
+      if (!removed[links[l].orig] && !removed[links[l].dest] && links[l].lower < links[l].upper) {
+        attach(l);
+        insert(l);
+      }
+    }
+
+    for (uint32_t v = n; v-- > 0;)
+      worklist.push_back(v);
+    while (!worklist.empty()) {
+      uint32_t x = worklist.back();
+      worklist.pop_back();
+      if (!removed[x] && x != source && x != sink && degree[x] <= 2)
+        eliminate(x);
+    }
+
+    reduced.clear();
+    coreVertex.assign(n, FlowNetwork<F>::NONE);
+    for (uint32_t v = 0; v < n; v++)
+      if (!removed[v] || v == source || v == sink)
+        coreVertex[v] = reduced.addVertex();
+    coreLinks.clear();
+    for (uint32_t l = 0; l < links.size(); l++) {
+      if (!alive[l])
+        continue;
+      reduced.addBoundedLink(coreVertex[links[l].orig], coreVertex[links[l].dest], links[l].lower, links[l].upper);
+      coreLinks.push_back(l);
+    }
+    reduced.finalize();
+    reduced.setTerminals(coreVertex[source], coreVertex[sink]);
+    return reduced;
+  }
+
+  /// The core built by the last contract()
+  FlowNetwork<F> &core() { return reduced; }
+
+  /**
+   * @brief Sets the flow of every link of the network from the flow of the core.
+   * @details Removed links get no flow.
+   * @note Time complexity: O(L) where L is the number of links.
+   */
+  void expand(FlowNetwork<F> &network) {
+    flows.assign(links.size(), 0);
+    for (uint32_t i = 0; i < coreLinks.size(); i++)
+      flows[coreLinks[i]] = reduced.getFlow(i);
+    for (auto it = steps.rbegin(); it != steps.rend(); ++it) {
+      const Link &r = links[it->result];
+      F f = flows[it->result];
+      if (it->series) {
+        // a joins r.orig to the removed vertex, b joins it to r.dest
+        flows[it->a] = links[it->a].orig == r.orig ? f : -f;
+        flows[it->b] = links[it->b].dest == r.dest ? f : -f;
+      } else {
+        bool forward = links[it->a].orig == r.orig;
+        F lo = forward ? links[it->a].lower : -links[it->a].upper;
+        F hi = forward ? links[it->a].upper : -links[it->a].lower;
+        F fa = std::clamp(f, lo, hi);
+        flows[it->a] = forward ? fa : -fa;
+        flows[it->b] = links[it->b].orig == r.orig ? f - fa : fa - f;
+      }
+    }
+    for (uint32_t l = 0; l < original; l++)
+      network.setFlow(l, flows[l]);
+  }
+
+private:
+  /// Link of the original network or made by a reduction, with its flow bounds
+  struct Link {
+    uint32_t orig, dest;
+    F lower, upper;
+  };
+
+  /// Reduction that replaced links a and b by the link result
+  struct Step {
+    uint32_t result, a, b;
+    bool series;
+  };
+
+  uint32_t source = FlowNetwork<F>::NONE, sink = FlowNetwork<F>::NONE;
+  /// Number of links of the original network (the first links)
+  uint32_t original = 0;
+  /// Capacity of the super source
+  F bound = 0;
+
+  std::vector<Link> links;
+  /// Whether each link is still in the network
+  std::vector<uint8_t> alive;
+  /// Links of each vertex, including removed ones
+  std::vector<std::vector<uint32_t>> adjacency;
+  /// Number of links of each vertex still in the network
+  std::vector<uint32_t> degree;
+  std::vector<uint8_t> removed;
+  /// Link still in the network between each pair of vertexes
+  std::unordered_map<uint64_t, uint32_t> between;
+  std::vector<Step> steps;
+  /// Vertexes whose degree has changed
+  std::vector<uint32_t> worklist;
+
+  FlowNetwork<F> reduced;
+  /// Vertex of the core of each vertex of the network
+  std::vector<uint32_t> coreVertex;
+  /// Link of each link of the core
+  std::vector<uint32_t> coreLinks;
+  std::vector<F> flows;
+
+  static uint64_t key(uint32_t u, uint32_t w) {
+    return u < w ? (uint64_t(u) << 32) | w : (uint64_t(w) << 32) | u;
+  }
+
+  uint32_t other(uint32_t l, uint32_t v) const {
+    return links[l].orig == v ? links[l].dest : links[l].orig;
+  }
+
+  /// Puts a link in the network
+  void attach(uint32_t l) {
+    alive[l] = 1;
+    for (uint32_t v : {links[l].orig, links[l].dest}) {
+      degree[v]++;
+      adjacency[v].push_back(l);
+    }
+  }
+
+  /// Takes a link out of the network
+  void detach(uint32_t l) {
+    alive[l] = 0;
+    for (uint32_t v : {links[l].orig, links[l].dest}) {
+      degree[v]--;
+      worklist.push_back(v);
+    }
+    auto it = between.find(key(links[l].orig, links[l].dest));
+    if (it != between.end() && it->second == l)
+      between.erase(it);
+  }
+
+  /// Adds a reduced link, in the orientation of link `like`
+  uint32_t create(const Link &like, F lower, F upper) {
+    links.push_back({like.orig, like.dest, lower, upper});
+    alive.push_back(0);
+    attach(links.size() - 1);
+    return links.size() - 1;
+  }
+
+  /// Indexes a link by its ends, merging it with the link already there
+  void insert(uint32_t l) {
+    auto [it, inserted] = between.try_emplace(key(links[l].orig, links[l].dest), l);
+    if (inserted)
+      return;
+    uint32_t e = it->second;
+    Link like = links[l];
+    bool forward = links[e].orig == like.orig;
+    F lower = std::max(-bound, like.lower + (forward ? links[e].lower : -links[e].upper));
+    F upper = std::min(bound, like.upper + (forward ? links[e].upper : -links[e].lower));
+    detach(e);
+    detach(l);
+    uint32_t r = create(like, lower, upper);
+    steps.push_back({r, e, l, false});
+    between[key(like.orig, like.dest)] = r;
+  }
+
+  /// Removes a vertex with at most two links
+  void eliminate(uint32_t x) {
+    uint32_t ends[2], count = 0;
+    for (uint32_t l : adjacency[x])
+      if (alive[l])
+        ends[count++] = l;
+    removed[x] = 1;
+    if (count < 2) {
+      if (count == 1)
+        detach(ends[0]);
+      return;
+    }
+
+    // series: a from u to x, then b from x to w (parallel links were merged, so u != w)
+    uint32_t a = ends[0], b = ends[1];
+    uint32_t u = other(a, x), w = other(b, x);
+    F lower = std::max(links[a].orig == u ? links[a].lower : -links[a].upper,
+                       links[b].orig == x ? links[b].lower : -links[b].upper);
+    F upper = std::min(links[a].orig == u ? links[a].upper : -links[a].lower,
+                       links[b].orig == x ? links[b].upper : -links[b].lower);
+    detach(a);
+    detach(b);
+    if (lower < upper) {
+      uint32_t r = create({u, w, lower, upper}, lower, upper);
+      steps.push_back({r, a, b, true});
+      insert(r);
+    }
+  }
+};
+
+#endif // DA2324_PRJ1_G163_CONTRACTION_H
@@ -0,0 +1,80 @@
+#ifndef DA2324_PRJ1_G163_EDMONDSKARP_H
+#define DA2324_PRJ1_G163_EDMONDSKARP_H
+
+#include "FlowNetwork.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * @brief Edmonds-Karp max-flow engine over a FlowNetwork.
+ * @details Repeatedly finds a shortest augmenting path (BFS in the residual
+ * network) from the super source to the super sink and saturates it. Disabled
+ * vertexes are never entered. The BFS arrays are kept between calls.
+ */
+template <class F>
+class EdmondsKarp {
+public:
+  /**
+   * @brief Increases the flow of the network until it is maximum.
+   * @details Starts from the current flow of the network (clear it first to solve from scratch).
+   * @note Time complexity: O(V * L^2) where V is the number of vertexes and L is the number of links.
+   * @return The flow added to the network.
+   */
+  F solve(FlowNetwork<F> &network) {
+    uint32_t n = network.getNumVertex();
+    uint32_t s = network.getSource();
+    uint32_t t = network.getSink();
+    parentArc.assign(n, FlowNetwork<F>::NONE);
+    parentVertex.assign(n, FlowNetwork<F>::NONE);
+    visited.assign(n, 0);
+    queue.resize(n);
+    stamp = 0;
+
+    F total = 0;
+    while (findAugmentingPath(network, s, t)) {
+      F f = std::numeric_limits<F>::max();
+      for (uint32_t v = t; v != s; v = parentVertex[v])
+        f = std::min(f, network.residual(parentArc[v]));
+      for (uint32_t v = t; v != s; v = parentVertex[v])
+        network.push(parentArc[v], f);
+      total += f;
+    }
+    return total;
+  }
+
+private:
+  /// Arc used to reach each vertex in the last BFS
+  std::vector<uint32_t> parentArc;
+  /// Vertex from where each vertex was reached in the last BFS
+  std::vector<uint32_t> parentVertex;
+  /// Number of the last BFS that visited each vertex (avoids clearing the array)
+  std::vector<uint32_t> visited;
+  /// BFS queue
+  std::vector<uint32_t> queue;
+  /// Number of the current BFS
+  uint32_t stamp = 0;
+
+  bool findAugmentingPath(const FlowNetwork<F> &network, uint32_t s, uint32_t t) {
+    ++stamp;
+    uint32_t head = 0, tail = 0;
+    queue[tail++] = s;
+    visited[s] = stamp;
+    while (head < tail && visited[t] != stamp) {
+      uint32_t v = queue[head++];
+      for (uint32_t a = network.arcBegin(v); a < network.arcEnd(v); a++) {
+        uint32_t w = network.arcHead(a);
+        if (visited[w] == stamp || !network.isActive(w) || network.residual(a) <= 0)
+          continue;
+        visited[w] = stamp;
+        parentArc[w] = a;
+        parentVertex[w] = v;
+        queue[tail++] = w;
+      }
+    }
+    return visited[t] == stamp;
+  }
+};
+
+#endif // DA2324_PRJ1_G163_EDMONDSKARP_H
@@ -0,0 +1,279 @@
+#ifndef DA2324_PRJ1_G163_FLOWNETWORK_H
+#define DA2324_PRJ1_G163_FLOWNETWORK_H
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Compact flow network used by the max-flow engines.
+ * @details The network is compiled once from Graph<Info> and then solved many
+ * times. It is stored as flat arrays instead of pointers:
+ * - every pipe is a *link* with a lower bound, an upper bound (capacity) and a
+ *   flow, kept in three parallel arrays (structure of arrays). A directed pipe has
+ *   lower bound 0; an undirected pipe has lower bound -capacity, so its flow is
+ *   negative when the water goes from the destination to the origin;
+ * - the adjacency of every vertex is a range of *arcs* in compressed rows (CSR).
+ *   Each link has a forward arc (stored in its origin) and a backward arc (stored
+ *   in its destination), with residual capacities `upper - flow` and
+ *   `flow - lower`. In each vertex the forward arcs come before the backward arcs.
+ *
+ * The super source and the super sink are ordinary vertexes of the network, so
+ * no auxiliary vertexes or edges are created in the graph.\n
+ * F is the capacity / flow type: `int32_t` or `int64_t` give exact results when
+ * every capacity is an integer, `double` supports fractional demands.
+ */
+template <class F>
+class FlowNetwork {
+  static_assert(std::is_arithmetic_v<F>, "The flow type must be a number");
+
+public:
+  /// Capacity / flow type
+  using Flow = F;
+
+  /// Marks a missing vertex or arc
+  static constexpr uint32_t NONE = UINT32_MAX;
+  /// Most links a network can have: the arcs of link l are `l << 1` and `(l << 1) | 1`, below NONE
+  static constexpr uint32_t MAX_LINKS = NONE >> 1;
+
+  FlowNetwork() = default;
+
+  /**
+   * @brief Copy of a network with another flow type.
+   * @details Keeps the vertexes, links, bounds, flows, active vertexes and terminals, so a solved
+   * integral network can be solved again with fractional capacities (see Data::flowCurve()).
+   */
+  template <class G>
+  explicit FlowNetwork(const FlowNetwork<G> &other)
+      : origs(other.origs), dests(other.dests), lower(other.lower.begin(), other.lower.end()),
+        upper(other.upper.begin(), other.upper.end()), flow(other.flow.begin(), other.flow.end()),
+        undirecteds(other.undirecteds), active(other.active), source(other.source), sink(other.sink),
+        first(other.first), heads(other.heads), arcs(other.arcs) {}
+
+  /**
+   * @brief Adds a vertex.
+   * @details Only valid before finalize().
+   * @throws std::length_error if the network already has NONE vertexes.
+   * @return Id of the new vertex.
+   */
+  uint32_t addVertex() {
+    if (active.size() >= NONE)
+      throw std::length_error("more than " + std::to_string(NONE - 1) + " vertexes");
+    active.push_back(1);
+    return active.size() - 1;
+  }
+
+  /**
+   * @brief Adds a link (a pipe) between two vertexes.
+   * @details Only valid before finalize().
+   * @param orig: Origin vertex
+   * @param dest: Destination vertex
+   * @param capacity: Upper bound of the flow
+   * @param undirected: If true, the flow can also go from dest to orig (down to -capacity).
+   * @throws std::length_error if the network already has MAX_LINKS links.
+   * @return Id of the new link.
+   */
+  uint32_t addLink(uint32_t orig, uint32_t dest, F capacity, bool undirected) {
+    checkLinks();
+    origs.push_back(orig);
+    dests.push_back(dest);
+    upper.push_back(capacity);
+    lower.push_back(undirected ? -capacity : 0);
+    flow.push_back(0);
+    undirecteds.push_back(undirected);
+    return upper.size() - 1;
+  }
+
+  /**
+   * @brief Adds a link whose flow can be anywhere in [lower, upper] (lower <= 0 <= upper).
+   * @details Used for the links of a contracted network, which stand for several pipes
+   * (see Contraction). Only valid before finalize().
+   * @throws std::length_error if the network already has MAX_LINKS links.
+   * @return Id of the new link.
+   */
+  uint32_t addBoundedLink(uint32_t orig, uint32_t dest, F lowerBound, F upperBound) {
+    checkLinks();
+    origs.push_back(orig);
+    dests.push_back(dest);
+    upper.push_back(upperBound);
+    lower.push_back(lowerBound);
+    flow.push_back(0);
+    undirecteds.push_back(lowerBound < 0);
+    return upper.size() - 1;
+  }
+
+  /// Removes every vertex and link, keeping the memory for the next network
+  void clear() {
+    origs.clear();
+    dests.clear();
+    lower.clear();
+    upper.clear();
+    flow.clear();
+    undirecteds.clear();
+    active.clear();
+    source = sink = NONE;
+  }
+
+  /**
+   * @brief Builds the adjacency arrays of the network.
+   * @note Time complexity: O(V + L) where V is the number of vertexes and L is the number of links.
+   */
+  void finalize() {
+    uint32_t n = getNumVertex();
+    first.assign(n + 1, 0);
+    for (uint32_t l = 0; l < getNumLinks(); l++) {
+      first[origs[l] + 1]++;
+      first[dests[l] + 1]++;
+    }
+    for (uint32_t v = 0; v < n; v++)
+      first[v + 1] += first[v];
+
+    std::vector<uint32_t> next(first.begin(), first.end() - 1);
+    heads.resize(2 * getNumLinks());
+    arcs.resize(2 * getNumLinks());
+    // forward arcs of every vertex first, then the backward arcs
+    for (uint32_t l = 0; l < getNumLinks(); l++) {
+      uint32_t a = next[origs[l]]++;
+      heads[a] = dests[l];
+      arcs[a] = l << 1;
+    }
+    for (uint32_t l = 0; l < getNumLinks(); l++) {
+      uint32_t a = next[dests[l]]++;
+      heads[a] = origs[l];
+      arcs[a] = (l << 1) | 1;
+    }
+  }
+
+  /// Number of vertexes (including the terminals)
+  uint32_t getNumVertex() const { return active.size(); }
+  /// Number of links
+  uint32_t getNumLinks() const { return upper.size(); }
+
+  /// Sets the super source and the super sink
+  void setTerminals(uint32_t s, uint32_t t) {
+    source = s;
+    sink = t;
+  }
+  /// Getter for the super source
+  uint32_t getSource() const { return source; }
+  /// Getter for the super sink
+  uint32_t getSink() const { return sink; }
+
+  /// Whether the flow can go through a vertex (disabled sites are skipped by the engines)
+  bool isActive(uint32_t v) const { return active[v]; }
+  /// Enables or disables a vertex
+  void setActive(uint32_t v, bool value) { active[v] = value; }
+
+  // Links
+
+  /// Origin of a link
+  uint32_t getOrig(uint32_t l) const { return origs[l]; }
+  /// Destination of a link
+  uint32_t getDest(uint32_t l) const { return dests[l]; }
+  /// Capacity (upper bound of the flow) of a link
+  F getCapacity(uint32_t l) const { return upper[l]; }
+  /// Lower bound of the flow of a link (0, or -capacity for undirected links)
+  F getLower(uint32_t l) const { return lower[l]; }
+  /// Whether the link can be used in both directions
+  bool isUndirected(uint32_t l) const { return undirecteds[l]; }
+  /// Current (signed) flow of a link
+  F getFlow(uint32_t l) const { return flow[l]; }
+  /// Sets the flow of a link
+  void setFlow(uint32_t l, F value) { flow[l] = value; }
+
+  /**
+   * @brief Changes the capacity of a link (0 removes the pipe from the network).
+   * @details The lower bound of an undirected link follows the capacity. The flow is not changed.
+   */
+  void setCapacity(uint32_t l, F capacity) {
+    upper[l] = capacity;
+    lower[l] = undirecteds[l] ? -capacity : 0;
+  }
+
+  /// Removes all the flow of the network
+  void clearFlow() { std::fill(flow.begin(), flow.end(), F(0)); }
+
+  /// Contiguous capacities of every link
+  const F *capacityData() const { return upper.data(); }
+  /// Contiguous flows of every link
+  const F *flowData() const { return flow.data(); }
+  /// Contiguous flows of every link
+  F *flowData() { return flow.data(); }
+
+  // Arcs
+
+  /// First arc of a vertex
+  uint32_t arcBegin(uint32_t v) const { return first[v]; }
+  /// One past the last arc of a vertex
+  uint32_t arcEnd(uint32_t v) const { return first[v + 1]; }
+  /// Vertex reached by an arc
+  uint32_t arcHead(uint32_t a) const { return heads[a]; }
+  /// Link of an arc
+  uint32_t arcLink(uint32_t a) const { return arcs[a] >> 1; }
+  /// Whether the arc goes in the direction of its link (from orig to dest)
+  bool isForward(uint32_t a) const { return !(arcs[a] & 1); }
+
+  /// Residual capacity of an arc: how much more flow it can carry
+  F residual(uint32_t a) const {
+    uint32_t l = arcs[a] >> 1;
+    return (arcs[a] & 1) ? flow[l] - lower[l] : upper[l] - flow[l];
+  }
+
+  /// Sends more flow through an arc (at most its residual capacity)
+  void push(uint32_t a, F value) {
+    uint32_t l = arcs[a] >> 1;
+    if (arcs[a] & 1)
+      flow[l] -= value;
+    else
+      flow[l] += value;
+  }
+
+  /// Residual capacity of a link in the direction that leaves vertex `from` (one of its ends)
+  F residualFrom(uint32_t l, uint32_t from) const {
+    return from == origs[l] ? upper[l] - flow[l] : flow[l] - lower[l];
+  }
+
+  /// Sends more flow through a link, leaving vertex `from` (one of its ends)
+  void pushFrom(uint32_t l, uint32_t from, F value) {
+    if (from == origs[l])
+      flow[l] += value;
+    else
+      flow[l] -= value;
+  }
+
+  /// Total flow leaving the super source
+  F value() const {
+    F total = 0;
+    for (uint32_t a = arcBegin(source); a < arcEnd(source); a++)
+      total += isForward(a) ? flow[arcLink(a)] : -flow[arcLink(a)];
+    return total;
+  }
+
+private:
+  template <class G> friend class FlowNetwork;
+
+  // links (structure of arrays)
+  std::vector<uint32_t> origs, dests;
+  std::vector<F> lower, upper, flow;
+  std::vector<uint8_t> undirecteds;
+
+  // vertexes
+  std::vector<uint8_t> active;
+  uint32_t source = NONE, sink = NONE;
+
+  // arcs in compressed rows: arcs of vertex v are [first[v], first[v + 1])
+  std::vector<uint32_t> first;
+  std::vector<uint32_t> heads;
+  std::vector<uint32_t> arcs; // link << 1 | backward
+
+  /// Rejects a new link that would not fit in the 32-bit arcs
+  void checkLinks() const {
+    if (upper.size() >= MAX_LINKS)
+      throw std::length_error("more than " + std::to_string(MAX_LINKS) + " links");
+  }
+};
+
+#endif // DA2324_PRJ1_G163_FLOWNETWORK_H
@@ -0,0 +1,313 @@
+#ifndef DA2324_PRJ1_G163_MINCOSTFLOW_H
+#define DA2324_PRJ1_G163_MINCOSTFLOW_H
+
+#include "FlowNetwork.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * @brief Min-cost max-flow engine over a FlowNetwork (cost scaling, Goldberg).
+ * @details Every link has a cost per unit of flow, paid in either direction (an undirected link
+ * costs `cost * |flow|`), and no cost is negative. Two maximum flows differ by a circulation, so
+ * the engine starts from the maximum flow already in the network and only moves flow around
+ * cycles of the residual arcs. Every vertex has a price, and a flow is ε-optimal when no residual
+ * arc has a reduced cost below -ε. Each phase (refine) divides ε by ALPHA: it saturates the arcs
+ * of negative reduced cost, and then pushes the excess of each vertex through the arcs of negative
+ * reduced cost, lowering the price of a vertex (relabel) when it has none left (push-relabel,
+ * first in first out). Disabled vertexes are never entered. The arrays are kept between calls.
+ *
+ * The costs are multiplied by the number of vertexes plus one and rounded to integers, so the
+ * flow of the phase with ε = 1 is optimal, and there are O(log(V C)) phases where C is the largest
+ * cost: the number of distinct costs does not matter. The costs are rounded to the finest power of
+ * two that keeps every price within 64 bits.
+ *
+ * The residual arc of an undirected link against its flow costs `-cost`, but only until the
+ * flow reaches 0: from there on, more flow in that direction costs `cost`. So an arc can only
+ * be used up to the next change of its cost.
+ */
+template <class F>
+class MinCostFlow {
+public:
+  /**
+   * @brief Turns the maximum flow in the network into a maximum flow of minimum cost.
+   * @note Time complexity: O(V^2 L log(V C)) where V is the number of vertexes, L is the number
+   * of links and C is the largest cost; much less in practice.
+   * @param cost: Cost per unit of flow of each link (>= 0)
+   * @return The cost of the flow.
+   */
+  double solve(FlowNetwork<F> &network, const std::vector<double> &cost) {
+    uint32_t n = network.getNumVertex();
+    scaleCosts(network, cost);
+    price.assign(n, 0);
+    excess.assign(n, 0);
+    current.resize(n);
+    queued.assign(n, false);
+    queue.resize(n);
+    settled.assign(n, false);
+
+    // with every price at 0, the flow is maxCost-optimal
+    int64_t eps = maxCost;
+    while (eps > 1) {
+      eps = std::max<int64_t>(1, eps / ALPHA);
+      refine(network, eps);
+    }
+
+    double total = 0;
+    for (uint32_t l = 0; l < network.getNumLinks(); l++)
+      total += cost[l] * std::abs(static_cast<double>(network.getFlow(l)));
+    return total;
+  }
+
+private:
+  /// Factor of ε between two phases
+  static constexpr int64_t ALPHA = 12;
+  /// Distance of the vertexes not reached by the price update yet
+  static constexpr uint32_t UNREACHED = std::numeric_limits<uint32_t>::max();
+
+  /// Cost of each link, multiplied by the number of vertexes plus one and rounded
+  std::vector<int64_t> scaled;
+  /// Largest of the scaled costs
+  int64_t maxCost = 0;
+  /// Price of each vertex: the reduced cost of an arc from v to w is `cost + price[v] - price[w]`
+  std::vector<int64_t> price;
+  /// Flow into each vertex minus the flow out of it, since the start of the solve
+  std::vector<F> excess;
+  /// Next arc to try from each vertex
+  std::vector<uint32_t> current;
+  /// Whether each vertex is in the queue
+  std::vector<uint8_t> queued;
+  /// Circular queue of the vertexes with excess
+  std::vector<uint32_t> queue;
+  uint32_t head = 0, size = 0;
+  /// Distance of each vertex to the nearest deficit, in the last price update (in units of ε)
+  std::vector<uint32_t> distance;
+  /// Whether the distance of each vertex is final, in the price update
+  std::vector<uint8_t> settled;
+  /// Vertexes by tentative distance, in the price update
+  std::vector<std::vector<uint32_t>> buckets;
+
+  /**
+   * @brief Fills the scaled costs.
+   * @details The prices move by less than 3 V ε per phase (Goldberg and Tarjan), so they stay within
+   * V times the largest scaled cost, which is kept below 2^61 / V.
+   */
+  void scaleCosts(const FlowNetwork<F> &network, const std::vector<double> &cost) {
+    uint32_t n = network.getNumVertex();
+    int bits = std::bit_width(uint64_t(n) + 1);
+    double largest = 0;
+    for (uint32_t l = 0; l < network.getNumLinks(); l++)
+      largest = std::max(largest, cost[l]);
+    int exponent = 0;
+    std::frexp(largest, &exponent);
+    // largest < 2^exponent, so every rounded cost is at most 2^(61 - 2 bits)
+    int shift = 61 - 2 * bits - exponent;
+    scaled.resize(network.getNumLinks());
+    maxCost = 0;
+    for (uint32_t l = 0; l < network.getNumLinks(); l++) {
+      scaled[l] = std::llround(std::ldexp(cost[l], shift)) * (int64_t(n) + 1);
+      maxCost = std::max(maxCost, scaled[l]);
+    }
+  }
+
+  /// Whether the flow leaving vertex `from` (one end of the link) goes against the flow of the link
+  static bool against(const FlowNetwork<F> &network, uint32_t l, uint32_t from) {
+    F flow = network.getFlow(l);
+    return from == network.getOrig(l) ? flow < 0 : flow > 0;
+  }
+
+  /// Cost of one more unit of flow through a link leaving vertex `from`, at its current flow
+  int64_t linkCost(const FlowNetwork<F> &network, uint32_t l, uint32_t from) const {
+    return against(network, l, from) ? -scaled[l] : scaled[l];
+  }
+
+  /// Flow that a link takes leaving vertex `from` before its cost changes (see linkCost())
+  static F linkResidual(const FlowNetwork<F> &network, uint32_t l, uint32_t from) {
+    F residual = network.residualFrom(l, from);
+    if (against(network, l, from)) {
+      F flow = network.getFlow(l);
+      residual = std::min(residual, flow < 0 ? F(-flow) : flow);
+    }
+    return residual;
+  }
+
+  /// Reduced cost of a link leaving vertex `from` to vertex `to`
+  int64_t reducedCost(const FlowNetwork<F> &network, uint32_t l, uint32_t from, uint32_t to) const {
+    return linkCost(network, l, from) + price[from] - price[to];
+  }
+
+  void push(FlowNetwork<F> &network, uint32_t l, uint32_t v, uint32_t w, F value) {
+    network.pushFrom(l, v, value);
+    excess[v] -= value;
+    excess[w] += value;
+    if (excess[w] > 0 && !queued[w]) {
+      queued[w] = true;
+      queue[(head + size++) % queue.size()] = w;
+    }
+  }
+
+  /**
+   * @brief Turns an (ALPHA ε)-optimal flow into an ε-optimal flow.
+   * @details Saturating the arcs of negative reduced cost makes the flow 0-optimal but leaves excess
+   * in some vertexes and deficit in others, which the pushes then cancel. The prices are updated
+   * from the deficits at the start, and again after every V relabels.
+   */
+  void refine(FlowNetwork<F> &network, int64_t eps) {
+    uint32_t n = network.getNumVertex();
+    head = size = 0;
+    for (uint32_t v = 0; v < n; v++) {
+      current[v] = network.arcBegin(v);
+      if (!network.isActive(v))
+        continue;
+      for (uint32_t a = network.arcBegin(v); a < network.arcEnd(v); a++) {
+        uint32_t l = network.arcLink(a), w = network.arcHead(a);
+        if (!network.isActive(w))
+          continue;
+        // the link can cost less once it reaches 0 flow, so it may be saturated twice
+        F r;
+        while ((r = linkResidual(network, l, v)) > 0 && reducedCost(network, l, v, w) < 0)
+          push(network, l, v, w, r);
+      }
+    }
+    uint32_t relabels = n;
+    while (size > 0) {
+      if (relabels >= n) {
+        updatePrices(network, eps);
+        relabels = 0;
+      }
+      uint32_t v = queue[head];
+      head = (head + 1) % queue.size();
+      size--;
+      queued[v] = false;
+      relabels += discharge(network, v, eps);
+    }
+  }
+
+  /**
+   * @brief Pushes all the excess of a vertex through the arcs of negative reduced cost, relabeling it
+   * when there are none left.
+   * @return The number of relabels (of the vertex, and of the vertexes it looked ahead to).
+   */
+  uint32_t discharge(FlowNetwork<F> &network, uint32_t v, int64_t eps) {
+    uint32_t relabels = 0;
+    while (excess[v] > 0) {
+      uint32_t &a = current[v];
+      if (a == network.arcEnd(v)) {
+        relabel(network, v, eps);
+        relabels++;
+        a = network.arcBegin(v);
+        continue;
+      }
+      uint32_t l = network.arcLink(a), w = network.arcHead(a);
+      F r;
+      if (!network.isActive(w) || (r = linkResidual(network, l, v)) <= 0 || reducedCost(network, l, v, w) >= 0) {
+        a++;
+        continue;
+      }
+      // look-ahead: a vertex without admissible arcs would only send the flow back, so it is relabeled first
+      if (excess[w] >= 0 && !admissible(network, w) && relabel(network, w, eps)) {
+        relabels++;
+        current[w] = network.arcBegin(w);
+        continue;
+      }
+      // the arc stays current while it has negative reduced cost, at a new segment or not
+      push(network, l, v, w, std::min(excess[v], r));
+    }
+    return relabels;
+  }
+
+  /// Whether a vertex has an arc of negative reduced cost, which becomes its current arc
+  bool admissible(const FlowNetwork<F> &network, uint32_t v) {
+    for (uint32_t &a = current[v]; a < network.arcEnd(v); a++) {
+      uint32_t l = network.arcLink(a), w = network.arcHead(a);
+      if (network.isActive(w) && linkResidual(network, l, v) > 0 && reducedCost(network, l, v, w) < 0)
+        return true;
+    }
+    return false;
+  }
+
+  /**
+   * @brief Lowers the price of a vertex as little as needed for a residual arc to reach reduced cost -ε.
+   * @return Whether the vertex has a residual arc (a vertex with excess always has one).
+   */
+  bool relabel(const FlowNetwork<F> &network, uint32_t v, int64_t eps) {
+    int64_t best = std::numeric_limits<int64_t>::min();
+    for (uint32_t a = network.arcBegin(v); a < network.arcEnd(v); a++) {
+      uint32_t l = network.arcLink(a), w = network.arcHead(a);
+      if (network.isActive(w) && linkResidual(network, l, v) > 0)
+        best = std::max(best, price[w] - linkCost(network, l, v));
+    }
+    if (best == std::numeric_limits<int64_t>::min())
+      return false;
+    price[v] = best - eps;
+    return true;
+  }
+
+  /**
+   * @brief Global price update: lowers every price by ε times its distance to the nearest deficit.
+   * @details A residual arc of reduced cost r is `r / ε + 1` long (rounded down), so the flow stays
+   * ε-optimal, and the excess finds admissible paths to the deficits. The distances are found
+   * backwards from the deficits with buckets (Dial), until every vertex with excess is reached;
+   * the vertexes left keep the distance reached by then.
+   */
+  void updatePrices(const FlowNetwork<F> &network, int64_t eps) {
+    uint32_t n = network.getNumVertex();
+    distance.assign(n, UNREACHED);
+    uint32_t missing = 0;
+    for (uint32_t v = 0; v < n; v++) {
+      current[v] = network.arcBegin(v);
+      if (!network.isActive(v))
+        continue;
+      if (excess[v] < 0)
+        reach(v, 0);
+      else if (excess[v] > 0)
+        missing++;
+    }
+    uint32_t level = 0;
+    for (; level < buckets.size(); level++) {
+      // the bucket can grow while it is read
+      for (size_t i = 0; missing > 0 && i < buckets[level].size(); i++) {
+        uint32_t w = buckets[level][i];
+        if (distance[w] != level || settled[w])
+          continue;
+        settled[w] = true;
+        if (excess[w] > 0 && --missing == 0)
+          break;
+        for (uint32_t a = network.arcBegin(w); a < network.arcEnd(w); a++) {
+          uint32_t l = network.arcLink(a), v = network.arcHead(a);
+          if (settled[v] || !network.isActive(v) || linkResidual(network, l, v) <= 0)
+            continue;
+          int64_t length = floorDiv(reducedCost(network, l, v, w), eps) + 1;
+          if (length < 0)
+            length = 0;
+          if (level + length < distance[v] && level + length < n)
+            reach(v, level + length);
+        }
+      }
+      if (missing == 0)
+        break;
+    }
+    // every vertex not settled is at least this far
+    for (uint32_t v = 0; v < n; v++) {
+      uint32_t d = settled[v] ? distance[v] : level;
+      price[v] -= eps * d;
+      settled[v] = false;
+    }
+    for (auto &bucket : buckets)
+      bucket.clear();
+  }
+
+  void reach(uint32_t v, uint32_t d) {
+    distance[v] = d;
+    if (buckets.size() <= d)
+      buckets.resize(d + 1);
+    buckets[d].push_back(v);
+  }
+
+  static int64_t floorDiv(int64_t a, int64_t b) { return a / b - (a % b != 0 && (a < 0) != (b < 0)); }
+};
+
+#endif // DA2324_PRJ1_G163_MINCOSTFLOW_H
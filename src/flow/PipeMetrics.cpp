@@ -0,0 +1,153 @@
+#include "PipeMetrics.h"
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define PIPE_METRICS_AVX2
+#endif
+
+namespace {
+
+/// Running sums of the remaining capacities, shifted by a constant
+struct Sums {
+  double shift = 0;
+  double sum = 0;
+  double squares = 0;
+  double max = 0;
+  uint64_t count = 0;
+};
+
+/// Index of the first pipe with flow (or n)
+template <class F> size_t firstWithFlow(const F *flow, size_t n) {
+  size_t i = 0;
+  while (i < n && flow[i] == 0)
+    i++;
+  return i;
+}
+
+/// Scalar accumulation of the pipes [begin, end)
+template <class F> void accumulate(Sums &sums, const F *capacity, const F *flow, size_t begin, size_t end) {
+  for (size_t i = begin; i < end; i++) {
+    if (flow[i] == 0)
+      continue;
+    double remaining = static_cast<double>(capacity[i]) - std::abs(static_cast<double>(flow[i]));
+    double shifted = remaining - sums.shift;
+    sums.sum += shifted;
+    sums.squares += shifted * shifted;
+    sums.max = std::max(sums.max, remaining);
+    sums.count++;
+  }
+}
+
+#ifdef PIPE_METRICS_AVX2
+__attribute__((target("avx2"))) inline __m256d load4(const double *p) { return _mm256_loadu_pd(p); }
+
+__attribute__((target("avx2"))) inline __m256d load4(const int32_t *p) {
+  return _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+}
+
+/// AVX2 accumulation of the first n - n % 4 pipes
+template <class F>
+__attribute__((target("avx2"))) size_t accumulateAvx2(Sums &sums, const F *capacity, const F *flow, size_t n) {
+  const __m256d zero = _mm256_setzero_pd();
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d signMask = _mm256_set1_pd(-0.0);
+  const __m256d shift = _mm256_set1_pd(sums.shift);
+  __m256d sum = zero, squares = zero, count = zero;
+  __m256d max = _mm256_set1_pd(sums.max);
+
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d c = load4(capacity + i);
+    __m256d f = load4(flow + i);
+    __m256d hasFlow = _mm256_cmp_pd(f, zero, _CMP_NEQ_OQ);
+    __m256d remaining = _mm256_sub_pd(c, _mm256_andnot_pd(signMask, f));
+    __m256d shifted = _mm256_and_pd(_mm256_sub_pd(remaining, shift), hasFlow);
+    sum = _mm256_add_pd(sum, shifted);
+    squares = _mm256_add_pd(squares, _mm256_mul_pd(shifted, shifted));
+    count = _mm256_add_pd(count, _mm256_and_pd(one, hasFlow));
+    max = _mm256_max_pd(max, _mm256_blendv_pd(zero, remaining, hasFlow));
+  }
+
+  alignas(32) double lanes[4][4];
+  _mm256_store_pd(lanes[0], sum);
+  _mm256_store_pd(lanes[1], squares);
+  _mm256_store_pd(lanes[2], count);
+  _mm256_store_pd(lanes[3], max);
+  for (int k = 0; k < 4; k++) {
+    sums.sum += lanes[0][k];
+    sums.squares += lanes[1][k];
+    sums.count += static_cast<uint64_t>(lanes[2][k]);
+    sums.max = std::max(sums.max, lanes[3][k]);
+  }
+  return i;
+}
+
+bool hasAvx2() {
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+}
+#endif
+
+/// Scalar accumulation of the first n - n % 4 pipes, in four lanes like the AVX2 kernel
+template <class F> size_t accumulateLanes(Sums &sums, const F *capacity, const F *flow, size_t n) {
+  double sum[4] = {}, squares[4] = {}, count[4] = {};
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    for (int k = 0; k < 4; k++) {
+      if (flow[i + k] == 0)
+        continue;
+      double remaining = static_cast<double>(capacity[i + k]) - std::abs(static_cast<double>(flow[i + k]));
+      double shifted = remaining - sums.shift;
+      sum[k] += shifted;
+      squares[k] += shifted * shifted;
+      count[k] += 1;
+      sums.max = std::max(sums.max, remaining);
+    }
+  }
+  for (int k = 0; k < 4; k++) {
+    sums.sum += sum[k];
+    sums.squares += squares[k];
+    sums.count += static_cast<uint64_t>(count[k]);
+  }
+  return i;
+}
+
+/// Accumulation of the first n - n % 4 pipes: AVX2 when available for F, otherwise the
+/// scalar loop with the same summation order (the results do not depend on the processor)
+template <class F> size_t accumulateBlocks(Sums &sums, const F *capacity, const F *flow, size_t n) {
+#ifdef PIPE_METRICS_AVX2
+  if constexpr (std::is_same_v<F, double> || std::is_same_v<F, int32_t>)
+    if (hasAvx2())
+      return accumulateAvx2(sums, capacity, flow, n);
+#endif
+  return accumulateLanes(sums, capacity, flow, n);
+}
+
+} // namespace
+
+template <class F>
+PipeMetrics computePipeMetrics(const F *capacity, const F *flow, size_t n) {
+  Sums sums;
+  size_t first = firstWithFlow(flow, n);
+  // no pipe with flow: every metric is 0 (instead of dividing by a count of 0)
+  if (first == n)
+    return PipeMetrics();
+  sums.shift = static_cast<double>(capacity[first]) - std::abs(static_cast<double>(flow[first]));
+  size_t done = accumulateBlocks(sums, capacity, flow, n);
+  accumulate(sums, capacity, flow, done, n);
+
+  PipeMetrics metrics;
+  metrics.count = sums.count;
+  metrics.max = sums.max;
+  double mean = sums.sum / sums.count;
+  metrics.avg = sums.shift + mean;
+  metrics.variance = std::max(0.0, sums.squares / sums.count - mean * mean);
+  return metrics;
+}
+
+template PipeMetrics computePipeMetrics<int32_t>(const int32_t *, const int32_t *, size_t);
+template PipeMetrics computePipeMetrics<int64_t>(const int64_t *, const int64_t *, size_t);
+template PipeMetrics computePipeMetrics<double>(const double *, const double *, size_t);
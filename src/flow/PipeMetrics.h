@@ -0,0 +1,37 @@
+#ifndef DA2324_PRJ1_G163_PIPEMETRICS_H
+#define DA2324_PRJ1_G163_PIPEMETRICS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Statistics of the remaining capacity (capacity - |flow|) of the pipes with flow.
+ */
+struct PipeMetrics {
+  /// Average remaining capacity
+  double avg = 0;
+  /// Variance of the remaining capacity (population variance)
+  double variance = 0;
+  /// Largest remaining capacity (at least 0)
+  double max = 0;
+  /// Number of pipes with flow
+  uint64_t count = 0;
+};
+
+/**
+ * @brief Computes the PipeMetrics of a set of pipes in a single pass.
+ * @details The pipes are given as two parallel arrays. Pipes without flow are ignored, and
+ * without any pipe with flow every metric is 0.
+ * On x86-64 processors with AVX2 the `double` and `int32_t` versions process four
+ * pipes per instruction (selected at runtime); otherwise a scalar loop is used.
+ * The variance is accumulated around the first remaining capacity, which avoids
+ * the cancellation of the naive sum of squares.
+ * @note Time complexity: O(n).
+ * @param capacity: Capacity of every pipe
+ * @param flow: Flow of every pipe (only its absolute value is used)
+ * @param n: Number of pipes
+ */
+template <class F>
+PipeMetrics computePipeMetrics(const F *capacity, const F *flow, size_t n);
+
+#endif // DA2324_PRJ1_G163_PIPEMETRICS_H
@@ -0,0 +1,255 @@
+#ifndef DA2324_PRJ1_G163_REROUTE_H
+#define DA2324_PRJ1_G163_REROUTE_H
+
+#include "FlowNetwork.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * @brief Local check of whether a change to a maximum flow can be absorbed without touching the super sink.
+ * @details Takes the same changes as BoykovKolmogorov (setCapacity() and setActive()), but instead of
+ * sending the cancelled flow back to the terminals it leaves an imbalance at the ends of each cancelled
+ * link: water that can no longer leave a vertex, or that no longer arrives at it. route() then looks for
+ * residual paths from the vertexes with water to spare to the vertexes missing water (searching from
+ * both ends at once), never through the super sink. If every imbalance is settled, the water was rerouted around the change and the flow
+ * into the super sink is the same.\n
+ * The search is bounded: it gives up after visiting a given number of vertexes, so a change that
+ * cannot be settled nearby is left to a global solve. Every change to the network is logged, and
+ * undo() puts the network back exactly as it was.
+ */
+template <class F>
+class Reroute {
+public:
+  /// Starts a new scenario on a solved network (forgets the log of the last one)
+  void begin(const FlowNetwork<F> &network) {
+    uint32_t n = network.getNumVertex();
+    if (imbalance.size() != n) {
+      imbalance.assign(n, 0);
+      parentArc.assign(n, FlowNetwork<F>::NONE);
+      nextLink.assign(n, FlowNetwork<F>::NONE);
+      forward.assign(n, 0);
+      backward.assign(n, 0);
+      forwardQueue.resize(n);
+      backwardQueue.resize(n);
+    }
+    for (uint32_t v : unbalanced)
+      imbalance[v] = 0;
+    unbalanced.clear();
+    flows.clear();
+    capacities.clear();
+    deactivated.clear();
+  }
+
+  /// Changes the capacity of a link, leaving the flow that no longer fits as an imbalance at its ends
+  void setCapacity(FlowNetwork<F> &network, uint32_t l, F capacity) {
+    capacities.push_back({l, network.getCapacity(l)});
+    network.setCapacity(l, capacity);
+    F flow = network.getFlow(l);
+    if (flow > network.getCapacity(l))
+      cancel(network, l, flow - network.getCapacity(l));
+    else if (flow < network.getLower(l))
+      cancel(network, l, flow - network.getLower(l));
+  }
+
+  /// Disables a vertex (enabling is left to undo()), leaving the flow through it as imbalances at its neighbours
+  void setActive(FlowNetwork<F> &network, uint32_t v, bool active) {
+    if (active || !network.isActive(v))
+      return;
+    deactivated.push_back(v);
+    network.setActive(v, false);
+    for (uint32_t a = network.arcBegin(v); a < network.arcEnd(v); a++)
+      if (network.getFlow(network.arcLink(a)) != 0)
+        cancel(network, network.arcLink(a), network.getFlow(network.arcLink(a)));
+  }
+
+  /**
+   * @brief Settles the imbalances with augmenting paths between them.
+   * @details Imbalances at disabled vertexes are ignored (they carry no flow any more).
+   * @note Time complexity: O(budget) per augmenting path, the budget being the number of vertexes
+   * the searches may expand in total.
+   * @return Whether every imbalance was settled within the budget.
+   */
+  bool route(FlowNetwork<F> &network, uint32_t budget) {
+    // the water to spare at the super source does not have to be sent: it only covers what is still missing
+    for (bool fromSource : {false, true}) {
+      for (uint32_t k = 0; k < unbalanced.size(); k++) {
+        uint32_t from = unbalanced[k];
+        if ((from == network.getSource()) != fromSource)
+          continue;
+        while (network.isActive(from) && imbalance[from] > 0 && (!fromSource || missing(network))) {
+          uint32_t meet;
+          uint32_t to = search(network, from, budget, meet);
+          if (to == FlowNetwork<F>::NONE)
+            return false;
+          F f = std::min(imbalance[from], -imbalance[to]);
+          for (uint32_t v = meet; v != from; v = arcTail(network, parentArc[v]))
+            f = std::min(f, network.residual(parentArc[v]));
+          for (uint32_t v = meet; v != to; v = other(network, nextLink[v], v))
+            f = std::min(f, network.residualFrom(nextLink[v], v));
+          for (uint32_t v = meet; v != from; v = arcTail(network, parentArc[v])) {
+            uint32_t l = network.arcLink(parentArc[v]);
+            flows.push_back({l, network.getFlow(l)});
+            network.push(parentArc[v], f);
+          }
+          for (uint32_t v = meet; v != to; v = other(network, nextLink[v], v)) {
+            flows.push_back({nextLink[v], network.getFlow(nextLink[v])});
+            network.pushFrom(nextLink[v], v, f);
+          }
+          imbalance[from] -= f;
+          imbalance[to] += f;
+        }
+      }
+    }
+    return !missing(network);
+  }
+
+  /// Calls visit(l) for every link whose flow changed since begin() (a link may be visited more than once)
+  template <class Visit> void changedLinks(Visit visit) const {
+    for (const auto &[l, flow] : flows)
+      visit(l);
+  }
+
+  /// Puts back every flow, capacity and vertex changed since begin()
+  void undo(FlowNetwork<F> &network) {
+    for (auto it = flows.rbegin(); it != flows.rend(); ++it)
+      network.setFlow(it->first, it->second);
+    for (auto it = capacities.rbegin(); it != capacities.rend(); ++it)
+      network.setCapacity(it->first, it->second);
+    for (uint32_t v : deactivated)
+      network.setActive(v, true);
+  }
+
+private:
+  /// Water to spare (positive) or missing (negative) at each vertex
+  std::vector<F> imbalance;
+  /// Vertexes whose imbalance may not be 0
+  std::vector<uint32_t> unbalanced;
+  /// Arc used to reach each vertex in the forward tree of the last search
+  std::vector<uint32_t> parentArc;
+  /// Link towards the vertex missing water of each vertex in the backward tree of the last search
+  std::vector<uint32_t> nextLink;
+  /// Number of the last search that reached each vertex forward and backward (avoids clearing the arrays)
+  std::vector<uint32_t> forward, backward;
+  /// Search queues
+  std::vector<uint32_t> forwardQueue, backwardQueue;
+  uint32_t stamp = 0;
+
+  /// Log of the previous flows and capacities of the changed links
+  std::vector<std::pair<uint32_t, F>> flows, capacities;
+  /// Vertexes disabled since begin()
+  std::vector<uint32_t> deactivated;
+
+  /// Whether an enabled vertex is still missing water
+  bool missing(const FlowNetwork<F> &network) const {
+    for (uint32_t v : unbalanced)
+      if (network.isActive(v) && imbalance[v] < 0)
+        return true;
+    return false;
+  }
+
+  /// Vertex an arc leaves from
+  static uint32_t arcTail(const FlowNetwork<F> &network, uint32_t a) {
+    uint32_t l = network.arcLink(a);
+    return network.isForward(a) ? network.getOrig(l) : network.getDest(l);
+  }
+
+  /// Removes some flow of a link (negative for flow from dest to orig), leaving it at its ends
+  void cancel(FlowNetwork<F> &network, uint32_t l, F value) {
+    flows.push_back({l, network.getFlow(l)});
+    network.setFlow(l, network.getFlow(l) - value);
+    addImbalance(network.getOrig(l), value);
+    addImbalance(network.getDest(l), -value);
+  }
+
+  void addImbalance(uint32_t v, F value) {
+    if (imbalance[v] == 0)
+      unbalanced.push_back(v);
+    imbalance[v] += value;
+  }
+
+  /// End of a link that is not v
+  static uint32_t other(const FlowNetwork<F> &network, uint32_t l, uint32_t v) {
+    return network.getOrig(l) == v ? network.getDest(l) : network.getOrig(l);
+  }
+
+  /**
+   * @brief Bidirectional breadth-first search in the residual network for a vertex missing water.
+   * @details Grows a tree forward from `from` and a tree backward from every vertex missing water,
+   * one layer of the smaller tree at a time, until they meet. Never enters disabled vertexes or the
+   * super sink, and spends the budget on every vertex it expands.
+   * @param meet: Set to the vertex where the trees met
+   * @return The vertex missing water at the end of the path, or FlowNetwork::NONE.
+   */
+  uint32_t search(const FlowNetwork<F> &network, uint32_t from, uint32_t &budget, uint32_t &meet) {
+    if (++stamp == 0) {
+      std::fill(forward.begin(), forward.end(), 0);
+      std::fill(backward.begin(), backward.end(), 0);
+      stamp = 1;
+    }
+    uint32_t fHead = 0, fTail = 0, bHead = 0, bTail = 0;
+    forwardQueue[fTail++] = from;
+    forward[from] = stamp;
+    for (uint32_t v : unbalanced) {
+      if (backward[v] != stamp && network.isActive(v) && imbalance[v] < 0) {
+        backward[v] = stamp;
+        nextLink[v] = FlowNetwork<F>::NONE;
+        backwardQueue[bTail++] = v;
+      }
+    }
+
+    while (fHead < fTail && bHead < bTail) {
+      if (fTail - fHead <= bTail - bHead) {
+        for (uint32_t end = fTail; fHead < end; fHead++) {
+          if (budget == 0)
+            return FlowNetwork<F>::NONE;
+          budget--;
+          uint32_t v = forwardQueue[fHead];
+          for (uint32_t a = network.arcBegin(v); a < network.arcEnd(v); a++) {
+            uint32_t w = network.arcHead(a);
+            if (forward[w] == stamp || !network.isActive(w) || w == network.getSink() || network.residual(a) <= 0)
+              continue;
+            forward[w] = stamp;
+            parentArc[w] = a;
+            if (backward[w] == stamp) {
+              meet = w;
+              return root(network, w);
+            }
+            forwardQueue[fTail++] = w;
+          }
+        }
+      } else {
+        for (uint32_t end = bTail; bHead < end; bHead++) {
+          if (budget == 0)
+            return FlowNetwork<F>::NONE;
+          budget--;
+          uint32_t v = backwardQueue[bHead];
+          for (uint32_t a = network.arcBegin(v); a < network.arcEnd(v); a++) {
+            uint32_t x = network.arcHead(a), l = network.arcLink(a);
+            if (backward[x] == stamp || !network.isActive(x) || x == network.getSink() ||
+                network.residualFrom(l, x) <= 0)
+              continue;
+            backward[x] = stamp;
+            nextLink[x] = l;
+            if (forward[x] == stamp) {
+              meet = x;
+              return root(network, x);
+            }
+            backwardQueue[bTail++] = x;
+          }
+        }
+      }
+    }
+    return FlowNetwork<F>::NONE;
+  }
+
+  /// Vertex missing water at the end of the backward tree path of v
+  uint32_t root(const FlowNetwork<F> &network, uint32_t v) const {
+    while (nextLink[v] != FlowNetwork<F>::NONE)
+      v = other(network, nextLink[v], v);
+    return v;
+  }
+};
+
+#endif // DA2324_PRJ1_G163_REROUTE_H
@@ -0,0 +1,75 @@
+#ifndef DA2324_PRJ1_G163_SOLVERS_H
+#define DA2324_PRJ1_G163_SOLVERS_H
+
+#include "BoykovKolmogorov.h"
+#include "EdmondsKarp.h"
+#include "FlowNetwork.h"
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+/// Max-flow engines that can solve a FlowNetwork
+enum class Solver : uint8_t { EdmondsKarp, BoykovKolmogorov };
+
+/// Entry of the solver registry
+struct SolverEntry {
+  /// The engine
+  Solver solver;
+  /// Name used in the command line and in the reports
+  const char *name;
+};
+
+/// Every registered engine, in the order they are profiled by the automatic selection
+inline constexpr SolverEntry SOLVERS[] = {
+    {Solver::EdmondsKarp, "edmonds-karp"},
+    {Solver::BoykovKolmogorov, "boykov-kolmogorov"},
+};
+
+/// Name of an engine
+inline const char *solverName(Solver solver) {
+  for (const SolverEntry &entry : SOLVERS)
+    if (entry.solver == solver)
+      return entry.name;
+  return "unknown";
+}
+
+/// Engine with the given name, or nothing if there is none
+inline std::optional<Solver> parseSolver(std::string_view name) {
+  for (const SolverEntry &entry : SOLVERS)
+    if (name == entry.name)
+      return entry.solver;
+  return {};
+}
+
+/**
+ * @brief One instance of every registered engine for the flow type F.
+ * @details The engines keep their arrays between solves, so a SolverSet is meant to be
+ * reused (one per thread).
+ */
+template <class F>
+class SolverSet {
+public:
+  /**
+   * @brief Increases the flow of the network until it is maximum with the given engine.
+   * @details Starts from the current flow of the network (clear it first to solve from scratch).
+   * @return The flow added to the network.
+   */
+  F solve(Solver solver, FlowNetwork<F> &network) {
+    switch (solver) {
+    case Solver::BoykovKolmogorov:
+      return boykovKolmogorov.solve(network);
+    case Solver::EdmondsKarp:
+    default:
+      return edmondsKarp.solve(network);
+    }
+  }
+
+  /// The engine that can solve a scenario incrementally from a saved state
+  BoykovKolmogorov<F> &incremental() { return boykovKolmogorov; }
+
+private:
+  EdmondsKarp<F> edmondsKarp;
+  BoykovKolmogorov<F> boykovKolmogorov;
+};
+
+#endif // DA2324_PRJ1_G163_SOLVERS_H
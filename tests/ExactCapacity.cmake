@@ -0,0 +1,30 @@
+# Loads a network whose capacities and demand are 2^24 + 1, which a float cannot hold, and checks
+# that the maximum flow keeps every unit, both from the csv files and from a snapshot of them.
+# Usage: cmake -DPROGRAM=<executable> -DWORK=<directory> -P ExactCapacity.cmake
+
+set(value 16777217)
+file(REMOVE_RECURSE "${WORK}")
+file(MAKE_DIRECTORY "${WORK}/csv")
+file(WRITE "${WORK}/csv/Reservoirs.csv"
+        "Reservoir,Municipality,Id,Code,Maximum Delivery (m3/sec)\nReservoir,Municipality,1,R_1,${value}\n")
+file(WRITE "${WORK}/csv/Stations.csv" "Id,Code\n1,PS_1\n")
+file(WRITE "${WORK}/csv/Cities.csv" "City,Id,Code,Demand,Population\nCity,1,C_1,${value}.00,1\n")
+file(WRITE "${WORK}/csv/Pipes.csv"
+        "Service_Point_A,Service_Point_B,Capacity,Direction\nR_1,PS_1,${value},1\nPS_1,C_1,${value},1\n")
+
+file(WRITE "${WORK}/commands.txt" "maxFlowCity\nquit\n")
+foreach (source IN ITEMS csv snapshot)
+    if (source STREQUAL "csv")
+        set(arguments "${WORK}/csv" --save-snapshot "${WORK}/network.snapshot")
+    else ()
+        set(arguments "${WORK}/network.snapshot")
+    endif ()
+    execute_process(COMMAND "${PROGRAM}" ${arguments}
+            INPUT_FILE "${WORK}/commands.txt"
+            OUTPUT_VARIABLE output
+            ERROR_VARIABLE output
+            TIMEOUT 60)
+    if (NOT output MATCHES "Max flow of the network: ${value}")
+        message(FATAL_ERROR "Expected a max flow of ${value} from the ${source}, but got:\n${output}")
+    endif ()
+endforeach ()
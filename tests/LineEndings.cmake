@@ -0,0 +1,40 @@
+# Loads a copy of a dataset with other line endings and checks what the program reads from it.
+# Usage: cmake -DPROGRAM=<executable> -DDATASET=<directory> -DENDING=<LF|CRLF|CR|LFCR> -DWORK=<directory>
+#              -P LineEndings.cmake
+
+string(ASCII 13 CR)
+set(LF "\n")
+if (ENDING STREQUAL "LF")
+    set(eol "${LF}")
+elseif (ENDING STREQUAL "CRLF")
+    set(eol "${CR}${LF}")
+elseif (ENDING STREQUAL "CR")
+    set(eol "${CR}")
+elseif (ENDING STREQUAL "LFCR")
+    set(eol "${LF}${CR}")
+else ()
+    message(FATAL_ERROR "Unknown line ending: ${ENDING}")
+endif ()
+
+file(REMOVE_RECURSE "${WORK}")
+file(MAKE_DIRECTORY "${WORK}")
+file(GLOB files "${DATASET}/*.csv")
+foreach (file IN LISTS files)
+    file(READ "${file}" content)
+    string(REPLACE "${CR}${LF}" "${LF}" content "${content}")
+    string(REPLACE "${LF}" "${eol}" content "${content}")
+    get_filename_component(name "${file}" NAME)
+    file(WRITE "${WORK}/${name}" "${content}")
+endforeach ()
+
+file(WRITE "${WORK}/commands.txt" "count\nmaxFlowCity\nquit\n")
+execute_process(COMMAND "${PROGRAM}" "${WORK}"
+        INPUT_FILE "${WORK}/commands.txt"
+        OUTPUT_VARIABLE output
+        ERROR_VARIABLE output
+        TIMEOUT 60)
+foreach (expected IN ITEMS "Cities: +10" "Reservoirs: +4" "Pumps: +12" "Max flow of the network: 1643")
+    if (NOT output MATCHES "${expected}")
+        message(FATAL_ERROR "Expected '${expected}' with ${ENDING} line endings, but got:\n${output}")
+    endif ()
+endforeach ()
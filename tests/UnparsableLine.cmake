@@ -0,0 +1,27 @@
+# Loads a copy of a dataset whose Cities file has a line that cannot be parsed, and checks that
+# the program stops and names the line instead of loading the cities before it.
+# Usage: cmake -DPROGRAM=<executable> -DDATASET=<directory> -DWORK=<directory> -P UnparsableLine.cmake
+
+file(REMOVE_RECURSE "${WORK}")
+file(MAKE_DIRECTORY "${WORK}")
+file(GLOB files "${DATASET}/*.csv")
+foreach (file IN LISTS files)
+    get_filename_component(name "${file}" NAME)
+    if (name MATCHES "^Cities")
+        set(cities "${WORK}/${name}")
+        file(WRITE "${cities}" "City,Id,Code,Demand,Population\n1.2.3,x\n")
+    else ()
+        file(COPY "${file}" DESTINATION "${WORK}")
+    endif ()
+endforeach ()
+
+file(WRITE "${WORK}/commands.txt" "count\nquit\n")
+execute_process(COMMAND "${PROGRAM}" "${WORK}"
+        INPUT_FILE "${WORK}/commands.txt"
+        RESULT_VARIABLE result
+        OUTPUT_VARIABLE output
+        ERROR_VARIABLE output
+        TIMEOUT 60)
+if (result EQUAL 0 OR NOT output MATCHES "Failed to parse line 2 of the csv file")
+    message(FATAL_ERROR "Expected the program to stop at line 2 of ${cities}, but got (${result}):\n${output}")
+endif ()